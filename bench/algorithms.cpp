@@ -0,0 +1,710 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Benchmarks of the parallel algorithms and partitioners, each compared with
+// a serial or alternative version of the same work.
+
+#include "bench.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+const std::size_t array_size = std::size_t(1) << 21;
+
+std::vector<unsigned> random_values(std::size_t n, unsigned max, unsigned seed)
+{
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<unsigned> dist(0, max);
+	std::vector<unsigned> out(n);
+	for (auto& x: out)
+		x = dist(gen);
+	return out;
+}
+
+const std::vector<unsigned>& random_input()
+{
+	static std::vector<unsigned> input = random_values(array_size, 1000000, 1);
+	return input;
+}
+
+// Scan input of the given size. Only the last size is kept since the largest
+// inputs take hundreds of megabytes.
+const std::vector<unsigned>& scan_input(std::size_t n)
+{
+	static std::vector<unsigned> input;
+	if (input.size() != n) {
+		input.clear();
+		input.shrink_to_fit();
+		input.resize(n);
+		for (std::size_t i = 0; i < n; i++)
+			input[i] = static_cast<unsigned>((i * 2654435761u) >> 12) & 0xff;
+	}
+	return input;
+}
+
+// Sort inputs with different key distributions:
+// 0: uniformly random, 1: already sorted, 2: reversed, 3: 16 distinct keys,
+// 4: sorted with 1% of the elements swapped at random
+const std::vector<unsigned>& sort_input(std::int64_t dist)
+{
+	static std::map<std::int64_t, std::vector<unsigned>> inputs;
+	auto it = inputs.find(dist);
+	if (it != inputs.end())
+		return it->second;
+
+	std::vector<unsigned> v;
+	switch (dist) {
+	case 0:
+		v = random_values(array_size, 0xffffffff, 2);
+		break;
+	case 1:
+	case 2:
+	case 4:
+		v.resize(array_size);
+		std::iota(v.begin(), v.end(), 0u);
+		if (dist == 2)
+			std::reverse(v.begin(), v.end());
+		if (dist == 4) {
+			std::mt19937 gen(3);
+			std::uniform_int_distribution<std::size_t> pos(0, array_size - 1);
+			for (std::size_t i = 0; i < array_size / 100; i++)
+				std::swap(v[pos(gen)], v[pos(gen)]);
+		}
+		break;
+	default:
+		v = random_values(array_size, 15, 4);
+		break;
+	}
+	return inputs[dist] = std::move(v);
+}
+
+// Square matrix used by the transpose and stencil benchmarks
+const std::size_t matrix_size = 1024;
+
+std::vector<double> matrix_input()
+{
+	std::vector<double> m(matrix_size * matrix_size);
+	for (std::size_t i = 0; i < m.size(); i++)
+		m[i] = static_cast<double>(i % 1000);
+	return m;
+}
+
+// One sweep of a 5-point stencil over a row of the matrix
+void stencil_row(const std::vector<double>& in, std::vector<double>& out, std::size_t i)
+{
+	const std::size_t n = matrix_size;
+	for (std::size_t j = 1; j < n - 1; j++)
+		out[i * n + j] = 0.2 * (in[i * n + j] + in[(i - 1) * n + j] + in[(i + 1) * n + j] + in[i * n + j - 1] + in[i * n + j + 1]);
+}
+
+// Random graph in compressed sparse row form, used by the traversal benchmarks
+struct graph {
+	std::vector<std::size_t> offsets;
+	std::vector<unsigned> edges;
+};
+
+const graph& random_graph()
+{
+	static graph g;
+	if (g.offsets.empty()) {
+		const unsigned nodes = 1 << 17;
+		const unsigned degree = 8;
+		std::mt19937 gen(5);
+		std::uniform_int_distribution<unsigned> dist(0, nodes - 1);
+		for (unsigned i = 0; i < nodes; i++) {
+			g.offsets.push_back(g.edges.size());
+			for (unsigned j = 0; j < degree; j++)
+				g.edges.push_back(dist(gen));
+		}
+		g.offsets.push_back(g.edges.size());
+	}
+	return g;
+}
+
+const std::map<unsigned, unsigned>& map_input()
+{
+	static std::map<unsigned, unsigned> m;
+	if (m.empty()) {
+		for (unsigned i = 0; i < (1 << 20); i++)
+			m.emplace(i, i);
+	}
+	return m;
+}
+
+// Number of elements for the loop body cost sweep, chosen so that each loop
+// does roughly the same amount of work
+std::size_t sweep_length(std::int64_t cost)
+{
+	return std::max<std::size_t>(256, (std::size_t(1) << 24) / (static_cast<std::size_t>(cost) + 15));
+}
+
+// Partitioner wrapper which counts how many times its range was split, which
+// is the number of tasks a parallel loop spawns for it
+template<typename Partitioner>
+class counting_partitioner {
+	Partitioner partitioner;
+	std::atomic<std::size_t>* splits;
+
+public:
+	counting_partitioner(Partitioner partitioner, std::atomic<std::size_t>& splits)
+		: partitioner(std::move(partitioner)), splits(&splits) {}
+	auto begin() const -> decltype(partitioner.begin())
+	{
+		return partitioner.begin();
+	}
+	auto end() const -> decltype(partitioner.end())
+	{
+		return partitioner.end();
+	}
+	counting_partitioner split()
+	{
+		counting_partitioner out(partitioner.split(), *splits);
+		if (out.begin() != out.end())
+			splits->fetch_add(1, std::memory_order_relaxed);
+		return out;
+	}
+	template<typename P = Partitioner>
+	auto next_chunk() -> decltype(std::declval<P&>().next_chunk())
+	{
+		return partitioner.next_chunk();
+	}
+};
+template<typename Partitioner>
+counting_partitioner<Partitioner> count_splits(Partitioner partitioner, std::atomic<std::size_t>& splits)
+{
+	return {std::move(partitioner), splits};
+}
+
+} // namespace
+
+// Prefix sums over 1e6 to 1e8 elements. std::inclusive_scan is only used when
+// the benchmarks are built as C++17, otherwise std::partial_sum computes the
+// same result serially.
+BENCH_ARGS(scan_serial, 1000000, 10000000, 100000000)
+{
+	state.pause_timing();
+	const auto& in = scan_input(static_cast<std::size_t>(state.arg()));
+	std::vector<unsigned> out(in.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+#if __cplusplus >= 201703L
+		std::inclusive_scan(in.begin(), in.end(), out.begin());
+#else
+		std::partial_sum(in.begin(), in.end(), out.begin());
+#endif
+		bench::do_not_optimize(out.back());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH_ARGS(scan_parallel, 1000000, 10000000, 100000000)
+{
+	state.pause_timing();
+	const auto& in = scan_input(static_cast<std::size_t>(state.arg()));
+	std::vector<unsigned> out(in.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_inclusive_scan(in, out.begin(), std::plus<unsigned>());
+		bench::do_not_optimize(out.back());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+
+// Sorting, with the key distribution selected by the argument
+BENCH_ARGS(sort_std, 0, 1, 2, 3, 4)
+{
+	state.pause_timing();
+	const auto& in = sort_input(state.arg());
+	std::vector<unsigned> data;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		state.pause_timing();
+		data = in;
+		state.resume_timing();
+		std::sort(data.begin(), data.end());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH_ARGS(sort_parallel, 0, 1, 2, 3, 4)
+{
+	state.pause_timing();
+	const auto& in = sort_input(state.arg());
+	std::vector<unsigned> data;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		state.pause_timing();
+		data = in;
+		state.resume_timing();
+		async::parallel_sort(data.begin(), data.end());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH_ARGS(stable_sort_parallel, 0, 1, 2, 3, 4)
+{
+	state.pause_timing();
+	const auto& in = sort_input(state.arg());
+	std::vector<unsigned> data;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		state.pause_timing();
+		data = in;
+		state.resume_timing();
+		async::parallel_stable_sort(data.begin(), data.end());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+
+// Merging two sorted halves
+BENCH(merge_std)
+{
+	state.pause_timing();
+	std::vector<unsigned> a = random_input(), b = sort_input(0);
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+	std::vector<unsigned> out(a.size() + b.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		std::merge(a.begin(), a.end(), b.begin(), b.end(), out.begin());
+		bench::do_not_optimize(out.back());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * out.size()));
+}
+BENCH(merge_parallel)
+{
+	state.pause_timing();
+	std::vector<unsigned> a = random_input(), b = sort_input(0);
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+	std::vector<unsigned> out(a.size() + b.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_merge(a, b, out.begin());
+		bench::do_not_optimize(out.back());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * out.size()));
+}
+
+// Partitioning and stream compaction, keeping about half of the elements
+namespace {
+struct is_small {
+	bool operator()(unsigned x) const
+	{
+		return x < 500000;
+	}
+};
+}
+BENCH(partition_std)
+{
+	state.pause_timing();
+	const auto& in = random_input();
+	std::vector<unsigned> data;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		state.pause_timing();
+		data = in;
+		state.resume_timing();
+		bench::do_not_optimize(std::partition(data.begin(), data.end(), is_small()));
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH(partition_parallel)
+{
+	state.pause_timing();
+	const auto& in = random_input();
+	std::vector<unsigned> data;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		state.pause_timing();
+		data = in;
+		state.resume_timing();
+		bench::do_not_optimize(async::parallel_partition(data, is_small()));
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH(stable_partition_parallel)
+{
+	state.pause_timing();
+	const auto& in = random_input();
+	std::vector<unsigned> data;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		state.pause_timing();
+		data = in;
+		state.resume_timing();
+		bench::do_not_optimize(async::parallel_stable_partition(data, is_small()));
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH(copy_if_std)
+{
+	state.pause_timing();
+	const auto& in = random_input();
+	std::vector<unsigned> out(in.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(std::copy_if(in.begin(), in.end(), out.begin(), is_small()));
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+BENCH(copy_if_parallel)
+{
+	state.pause_timing();
+	const auto& in = random_input();
+	std::vector<unsigned> out(in.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(async::parallel_copy_if(in, out.begin(), is_small()));
+	state.set_items_processed(static_cast<double>(state.iterations() * in.size()));
+}
+
+// Searching, with the argument giving the position of the only match as a
+// percentage of the length. 100 means there is no match.
+namespace {
+std::vector<unsigned> find_input(std::int64_t percent)
+{
+	std::vector<unsigned> v(array_size * 4, 0);
+	std::size_t pos = v.size() * static_cast<std::size_t>(percent) / 100;
+	if (pos < v.size())
+		v[pos] = 1;
+	return v;
+}
+struct is_one {
+	bool operator()(unsigned x) const
+	{
+		return x == 1;
+	}
+};
+}
+BENCH_ARGS(find_std, 1, 50, 100)
+{
+	state.pause_timing();
+	std::vector<unsigned> data = find_input(state.arg());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(std::find_if(data.begin(), data.end(), is_one()));
+}
+BENCH_ARGS(find_first_parallel, 1, 50, 100)
+{
+	state.pause_timing();
+	std::vector<unsigned> data = find_input(state.arg());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(async::parallel_find_first(data, is_one()));
+}
+BENCH_ARGS(find_if_parallel, 1, 50, 100)
+{
+	state.pause_timing();
+	std::vector<unsigned> data = find_input(state.arg());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(async::parallel_find_if(data, is_one()));
+}
+
+// Traversal of all nodes reachable from the first node of a random graph
+BENCH(graph_traversal_serial)
+{
+	state.pause_timing();
+	const graph& g = random_graph();
+	std::size_t nodes = g.offsets.size() - 1;
+	std::vector<char> visited(nodes);
+	std::vector<unsigned> queue;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		std::fill(visited.begin(), visited.end(), 0);
+		queue.assign(1, 0);
+		visited[0] = 1;
+		while (!queue.empty()) {
+			unsigned node = queue.back();
+			queue.pop_back();
+			for (std::size_t e = g.offsets[node]; e != g.offsets[node + 1]; e++) {
+				unsigned next = g.edges[e];
+				if (!visited[next]) {
+					visited[next] = 1;
+					queue.push_back(next);
+				}
+			}
+		}
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * g.edges.size()));
+}
+BENCH(graph_traversal_parallel_do)
+{
+	state.pause_timing();
+	const graph& g = random_graph();
+	std::size_t nodes = g.offsets.size() - 1;
+	std::unique_ptr<std::atomic<bool>[]> visited(new std::atomic<bool>[nodes]);
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (std::size_t j = 0; j < nodes; j++)
+			visited[j].store(false, std::memory_order_relaxed);
+		visited[0].store(true, std::memory_order_relaxed);
+		std::vector<unsigned> roots(1, 0);
+		async::parallel_do(roots, [&g, &visited](unsigned node, async::parallel_do_feeder<unsigned>& feeder) {
+			for (std::size_t e = g.offsets[node]; e != g.offsets[node + 1]; e++) {
+				unsigned next = g.edges[e];
+				if (!visited[next].load(std::memory_order_relaxed) && !visited[next].exchange(true, std::memory_order_relaxed))
+					feeder.add(next);
+			}
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * g.edges.size()));
+}
+
+// Matrix transpose, split by rows or into 2D tiles
+BENCH(transpose_rows)
+{
+	state.pause_timing();
+	const std::size_t n = matrix_size;
+	std::vector<double> a = matrix_input(), b(a.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::irange(std::size_t(0), n), [&a, &b, n](std::size_t r) {
+			for (std::size_t c = 0; c < n; c++)
+				b[c * n + r] = a[r * n + c];
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * a.size()));
+}
+BENCH(transpose_blocked)
+{
+	state.pause_timing();
+	const std::size_t n = matrix_size;
+	std::vector<double> a = matrix_input(), b(a.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::blocked_range2d<std::size_t>(0, n, 0, n, 32, 32), [&a, &b, n](const std::array<std::size_t, 2>& p) {
+			b[p[1] * n + p[0]] = a[p[0] * n + p[1]];
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * a.size()));
+}
+
+// Repeated stencil sweeps over the same matrix. With affinity_partitioner each
+// row goes back to the worker which processed it in the previous sweep.
+BENCH(stencil_auto)
+{
+	state.pause_timing();
+	std::vector<double> a = matrix_input(), b(a.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::irange(std::size_t(1), matrix_size - 1), [&a, &b](std::size_t r) {
+			stencil_row(a, b, r);
+		});
+		std::swap(a, b);
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * a.size()));
+}
+BENCH(stencil_affinity)
+{
+	state.pause_timing();
+	std::vector<double> a = matrix_input(), b(a.size());
+	async::affinity_partitioner affinity;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(affinity(async::irange(std::size_t(1), matrix_size - 1)), [&a, &b](std::size_t r) {
+			stencil_row(a, b, r);
+		});
+		std::swap(a, b);
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * a.size()));
+}
+BENCH(stencil_blocked)
+{
+	state.pause_timing();
+	const std::size_t n = matrix_size;
+	std::vector<double> a = matrix_input(), b(a.size());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::blocked_range2d<std::size_t>(1, n - 1, 1, n - 1, 16, 64), [&a, &b, n](const std::array<std::size_t, 2>& p) {
+			std::size_t k = p[0] * n + p[1];
+			b[k] = 0.2 * (a[k] + a[k - n] + a[k + n] + a[k - 1] + a[k + 1]);
+		});
+		std::swap(a, b);
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * a.size()));
+}
+
+// Loops over a std::map, whose iterators are not random access
+BENCH(map_serial)
+{
+	state.pause_timing();
+	const auto& m = map_input();
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (const auto& kv: m)
+			bench::do_not_optimize(kv.second);
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * m.size()));
+}
+BENCH(map_static_partitioner)
+{
+	state.pause_timing();
+	const auto& m = map_input();
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::static_partitioner(m, 1024), [](const std::pair<const unsigned, unsigned>& kv) {
+			bench::do_not_optimize(kv.second);
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * m.size()));
+}
+BENCH(map_segmented)
+{
+	state.pause_timing();
+	const auto& m = map_input();
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::segmented(m, 1024), [](const std::pair<const unsigned, unsigned>& kv) {
+			bench::do_not_optimize(kv.second);
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * m.size()));
+}
+
+// Serial loops over a unit-stride int_range and over a strided_int_range with
+// a step of 1, compared with a plain loop. The int_range iterator only holds
+// the current value, so it should be as fast as the plain loop.
+BENCH(range_loop_plain)
+{
+	std::vector<unsigned> out(1 << 20);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (unsigned j = 0; j < out.size(); j++)
+			out[j] = 3 * j + 1;
+		bench::do_not_optimize(out.data());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * out.size()));
+}
+BENCH(range_loop_irange)
+{
+	std::vector<unsigned> out(1 << 20);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (unsigned j: async::irange(0u, static_cast<unsigned>(out.size())))
+			out[j] = 3 * j + 1;
+		bench::do_not_optimize(out.data());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * out.size()));
+}
+BENCH(range_loop_strided)
+{
+	std::vector<unsigned> out(1 << 20);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (unsigned j: async::irange(0u, static_cast<unsigned>(out.size()), 1))
+			out[j] = 3 * j + 1;
+		bench::do_not_optimize(out.data());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * out.size()));
+}
+
+// Partitioners on loops whose body cost, given by the argument, ranges from a
+// few nanoseconds to tens of microseconds per element
+#define PARTITIONER_SWEEP 1, 10, 100, 1000, 10000
+BENCH_ARGS(sweep_static_grain1, PARTITIONER_SWEEP)
+{
+	state.pause_timing();
+	std::uint64_t cost = state.arg();
+	std::size_t n = sweep_length(state.arg());
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::static_partitioner(async::irange(std::size_t(0), n), 1), [cost](std::size_t) {
+			bench::spin(cost);
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * n));
+}
+BENCH_ARGS(sweep_auto, PARTITIONER_SWEEP)
+{
+	state.pause_timing();
+	std::uint64_t cost = state.arg();
+	std::size_t n = sweep_length(state.arg());
+	std::atomic<std::size_t> tasks(0);
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(count_splits(async::auto_partitioner(async::irange(std::size_t(0), n)), tasks), [cost](std::size_t) {
+			bench::spin(cost);
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * n));
+	state.counter("tasks", static_cast<double>(tasks.load()) / static_cast<double>(state.iterations()));
+}
+BENCH_ARGS(sweep_lazy, PARTITIONER_SWEEP)
+{
+	state.pause_timing();
+	std::uint64_t cost = state.arg();
+	std::size_t n = sweep_length(state.arg());
+	std::atomic<std::size_t> tasks(0);
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(count_splits(async::lazy_partitioner(async::irange(std::size_t(0), n)), tasks), [cost](std::size_t) {
+			bench::spin(cost);
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * n));
+	state.counter("tasks", static_cast<double>(tasks.load()) / static_cast<double>(state.iterations()));
+}
+BENCH_ARGS(sweep_adaptive, PARTITIONER_SWEEP)
+{
+	state.pause_timing();
+	std::uint64_t cost = state.arg();
+	std::size_t n = sweep_length(state.arg());
+	async::grain_tuner tuner;
+	state.resume_timing();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(async::adaptive_partitioner(async::irange(std::size_t(0), n), tuner), [cost](std::size_t) {
+			bench::spin(cost);
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * n));
+	state.counter("ns_per_element", tuner.ns_per_element());
+}
+
+// Nested loops, where the inner loops run while the pool is already busy.
+// lazy_partitioner avoids splitting the inner loops in that case.
+BENCH(nested_auto)
+{
+	std::atomic<std::size_t> tasks(0);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(count_splits(async::auto_partitioner(async::irange(0, 64)), tasks), [&tasks](int) {
+			async::parallel_for(count_splits(async::auto_partitioner(async::irange(0, 4096)), tasks), [](int) {
+				bench::spin(10);
+			});
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * 64 * 4096));
+	state.counter("tasks", static_cast<double>(tasks.load()) / static_cast<double>(state.iterations()));
+}
+BENCH(nested_lazy)
+{
+	std::atomic<std::size_t> tasks(0);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::parallel_for(count_splits(async::lazy_partitioner(async::irange(0, 64)), tasks), [&tasks](int) {
+			async::parallel_for(count_splits(async::lazy_partitioner(async::irange(0, 4096)), tasks), [](int) {
+				bench::spin(10);
+			});
+		});
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * 64 * 4096));
+	state.counter("tasks", static_cast<double>(tasks.load()) / static_cast<double>(state.iterations()));
+}
+
+BENCH_MAIN()
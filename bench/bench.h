@@ -0,0 +1,359 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Small self-contained benchmark harness. Each benchmark is a function which
+// runs its body state.iterations() times. The harness picks an iteration count
+// which makes each run last for at least --min-time seconds, repeats the run
+// and reports the median time per iteration. Results can be written as JSON so
+// that they can be compared between commits.
+
+#ifndef ASYNCXX_BENCH_H_
+#define ASYNCXX_BENCH_H_
+
+#include <async++.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Revision of the source tree, filled in by CMake
+#ifndef ASYNCXX_BENCH_REVISION
+# define ASYNCXX_BENCH_REVISION "unknown"
+#endif
+
+namespace bench {
+
+typedef std::chrono::steady_clock clock_type;
+
+// Prevent the compiler from optimizing away a computed value. The overload
+// for non-const values also makes the compiler assume that the value may have
+// been modified, so that it can't be constant folded.
+template<typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* volatile sink;
+	sink = &value;
+#endif
+}
+template<typename T>
+inline void do_not_optimize(T& value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : "+m"(value) : : "memory");
+#else
+	static volatile void* volatile sink;
+	sink = &value;
+#endif
+}
+
+// Busy loop which does roughly the given amount of work, used to simulate
+// loop bodies of a known cost
+inline std::uint64_t spin(std::uint64_t n)
+{
+	std::uint64_t x = n;
+	for (std::uint64_t i = 0; i < n; i++) {
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+		do_not_optimize(x);
+	}
+	return x;
+}
+
+// Parameters of a single run of a benchmark
+class state {
+	std::size_t num_iterations;
+	std::int64_t argument;
+	clock_type::duration paused;
+	clock_type::time_point pause_start;
+	double items;
+	std::vector<std::pair<std::string, double>> user_counters;
+
+public:
+	state(std::size_t num_iterations, std::int64_t argument)
+		: num_iterations(num_iterations), argument(argument), paused(clock_type::duration::zero()), items(0) {}
+
+	// Number of times the benchmark body should run
+	std::size_t iterations() const
+	{
+		return num_iterations;
+	}
+
+	// Argument of the benchmark, 0 if it doesn't take one
+	std::int64_t arg() const
+	{
+		return argument;
+	}
+
+	// Exclude setup work from the measured time
+	void pause_timing()
+	{
+		pause_start = clock_type::now();
+	}
+	void resume_timing()
+	{
+		paused += clock_type::now() - pause_start;
+	}
+	clock_type::duration paused_time() const
+	{
+		return paused;
+	}
+
+	// Total number of items processed over all iterations, used to report a
+	// throughput
+	void set_items_processed(double n)
+	{
+		items = n;
+	}
+	double items_processed() const
+	{
+		return items;
+	}
+
+	// Extra values to report with the results
+	void counter(const std::string& name, double value)
+	{
+		for (auto& c: user_counters) {
+			if (c.first == name) {
+				c.second = value;
+				return;
+			}
+		}
+		user_counters.emplace_back(name, value);
+	}
+	const std::vector<std::pair<std::string, double>>& counters() const
+	{
+		return user_counters;
+	}
+};
+
+struct benchmark {
+	std::string name;
+	std::function<void(state&)> func;
+	std::vector<std::int64_t> args;
+};
+
+inline std::vector<benchmark>& registry()
+{
+	static std::vector<benchmark> benchmarks;
+	return benchmarks;
+}
+
+// Registers a benchmark when constructed, used by the BENCH macros
+struct registrar {
+	registrar(const char* name, void (*func)(state&), std::initializer_list<std::int64_t> args = {})
+	{
+		registry().push_back(benchmark{name, func, args});
+	}
+};
+
+// Result of a benchmark for a single argument
+struct result {
+	std::string name;
+	std::size_t iterations;
+	double ns_per_iteration;
+	double min_ns_per_iteration;
+	double max_ns_per_iteration;
+	double items_per_second;
+	std::vector<std::pair<std::string, double>> counters;
+};
+
+struct options {
+	std::string filter;
+	double min_time = 0.5;
+	int repetitions = 3;
+	std::string json;
+	bool list = false;
+};
+
+inline options parse_options(int argc, char* argv[])
+{
+	options opts;
+	for (int i = 1; i < argc; i++) {
+		const char* a = argv[i];
+		if (std::strncmp(a, "--filter=", 9) == 0)
+			opts.filter = a + 9;
+		else if (std::strncmp(a, "--min-time=", 11) == 0)
+			opts.min_time = std::atof(a + 11);
+		else if (std::strncmp(a, "--repetitions=", 14) == 0)
+			opts.repetitions = std::max(1, std::atoi(a + 14));
+		else if (std::strncmp(a, "--json=", 7) == 0)
+			opts.json = a + 7;
+		else if (std::strcmp(a, "--json") == 0)
+			opts.json = "-";
+		else if (std::strcmp(a, "--list") == 0)
+			opts.list = true;
+		else {
+			std::fprintf(stderr, "usage: %s [--filter=SUBSTRING] [--min-time=SECONDS] [--repetitions=N] [--json[=FILE]] [--list]\n", argv[0]);
+			std::exit(a[0] == '-' && a[1] == 'h' ? 0 : 1);
+		}
+	}
+	return opts;
+}
+
+// Run a benchmark once and return the measured time in nanoseconds
+inline double run_once(const benchmark& b, std::int64_t arg, std::size_t iterations, state*& last)
+{
+	state* s = new state(iterations, arg);
+	auto start = clock_type::now();
+	b.func(*s);
+	auto elapsed = clock_type::now() - start - s->paused_time();
+	delete last;
+	last = s;
+	return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+inline result run_benchmark(const benchmark& b, const std::string& name, std::int64_t arg, const options& opts)
+{
+	// Grow the iteration count until a run takes long enough
+	state* last = nullptr;
+	double min_ns = opts.min_time * 1e9;
+	std::size_t iterations = 1;
+	while (true) {
+		double ns = run_once(b, arg, iterations, last);
+		if (ns >= min_ns || iterations >= 1000000000)
+			break;
+		double scale = ns > 0 ? 1.4 * min_ns / ns : 100;
+		iterations = static_cast<std::size_t>(iterations * std::min(std::max(scale, 2.0), 100.0));
+	}
+
+	std::vector<double> times;
+	for (int i = 0; i < opts.repetitions; i++)
+		times.push_back(run_once(b, arg, iterations, last) / iterations);
+	std::sort(times.begin(), times.end());
+
+	result r;
+	r.name = name;
+	r.iterations = iterations;
+	r.ns_per_iteration = times[times.size() / 2];
+	r.min_ns_per_iteration = times.front();
+	r.max_ns_per_iteration = times.back();
+	r.items_per_second = last->items_processed() / iterations / r.ns_per_iteration * 1e9;
+	r.counters = last->counters();
+	delete last;
+	return r;
+}
+
+inline void write_json(std::FILE* f, const std::vector<result>& results, const char* program)
+{
+	char date[64];
+	std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+	std::fprintf(f, "{\n  \"context\": {\n");
+	std::fprintf(f, "    \"program\": \"%s\",\n", program);
+	std::fprintf(f, "    \"date\": \"%s\",\n", date);
+	std::fprintf(f, "    \"revision\": \"%s\",\n", ASYNCXX_BENCH_REVISION);
+	std::fprintf(f, "    \"num_threads\": %zu,\n", async::default_threadpool_scheduler().num_threads());
+	std::fprintf(f, "    \"hardware_concurrency\": %zu\n", async::hardware_concurrency());
+	std::fprintf(f, "  },\n  \"benchmarks\": [");
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const result& r = results[i];
+		std::fprintf(f, "%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_iteration\": %.3f, \"min_ns_per_iteration\": %.3f, \"max_ns_per_iteration\": %.3f",
+		             i ? "," : "", r.name.c_str(), r.iterations, r.ns_per_iteration, r.min_ns_per_iteration, r.max_ns_per_iteration);
+		if (r.items_per_second > 0)
+			std::fprintf(f, ", \"items_per_second\": %.3f", r.items_per_second);
+		for (const auto& c: r.counters)
+			std::fprintf(f, ", \"%s\": %.3f", c.first.c_str(), c.second);
+		std::fprintf(f, "}");
+	}
+	std::fprintf(f, "\n  ]\n}\n");
+}
+
+// Run all registered benchmarks matching the filter given on the command line
+inline int run(int argc, char* argv[])
+{
+	options opts = parse_options(argc, argv);
+	bool table = opts.json != "-";
+	if (table && !opts.list)
+		std::printf("%-40s %14s %14s %14s\n", "benchmark", "ns/iter", "iterations", "items/s");
+
+	std::vector<result> results;
+	for (const benchmark& b: registry()) {
+		std::vector<std::int64_t> args = b.args;
+		if (args.empty())
+			args.push_back(0);
+		for (std::int64_t arg: args) {
+			std::string name = b.name;
+			if (!b.args.empty())
+				name += "/" + std::to_string(arg);
+			if (name.find(opts.filter) == std::string::npos)
+				continue;
+			if (opts.list) {
+				std::printf("%s\n", name.c_str());
+				continue;
+			}
+
+			result r = run_benchmark(b, name, arg, opts);
+			if (table) {
+				std::printf("%-40s %14.1f %14zu", r.name.c_str(), r.ns_per_iteration, r.iterations);
+				if (r.items_per_second > 0)
+					std::printf(" %14.4g", r.items_per_second);
+				for (const auto& c: r.counters)
+					std::printf(" %s=%g", c.first.c_str(), c.second);
+				std::printf("\n");
+				std::fflush(stdout);
+			}
+			results.push_back(std::move(r));
+		}
+	}
+
+	if (opts.json.empty() || opts.list)
+		return 0;
+	std::FILE* f = opts.json == "-" ? stdout : std::fopen(opts.json.c_str(), "w");
+	if (!f) {
+		std::perror(opts.json.c_str());
+		return 1;
+	}
+	write_json(f, results, argv[0]);
+	if (f != stdout)
+		std::fclose(f);
+	return 0;
+}
+
+} // namespace bench
+
+// Define a benchmark, optionally run once for each of a list of arguments
+#define BENCH(name) \
+	static void name(bench::state& state); \
+	static bench::registrar name##_registrar(#name, name); \
+	static void name(bench::state& state)
+#define BENCH_ARGS(name, ...) \
+	static void name(bench::state& state); \
+	static bench::registrar name##_registrar(#name, name, {__VA_ARGS__}); \
+	static void name(bench::state& state)
+
+// Define main() to run all benchmarks in the program
+#define BENCH_MAIN() \
+	int main(int argc, char* argv[]) \
+	{ \
+		return bench::run(argc, argv); \
+	}
+
+#endif
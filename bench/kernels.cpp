@@ -0,0 +1,606 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Classic task-parallel kernels in the style of the Cilk and BOTS benchmark
+// suites, used to judge the quality of work stealing. Each kernel is run on
+// thread pools of increasing size and its speedup over a single worker is
+// reported as CSV. The result of every run is checked against a serial
+// version of the kernel.
+
+#include <async++.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Recursive Fibonacci, spawning one branch of each call until the cutoff
+const int fib_n = 34;
+const int fib_cutoff = 12;
+
+std::uint64_t fib_serial(int n)
+{
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+template<typename Sched>
+std::uint64_t fib(Sched& sched, int n)
+{
+	if (n < fib_cutoff)
+		return fib_serial(n);
+	std::uint64_t a;
+	auto&& t = async::local_spawn(sched, [&sched, &a, n] {
+		a = fib(sched, n - 1);
+	});
+	std::uint64_t b = fib(sched, n - 2);
+	t.get();
+	return a + b;
+}
+
+// Count the solutions of the n-queens problem. Each possible placement in the
+// first rows is a separate task.
+const int nqueens_n = 12;
+const int nqueens_cutoff = 3;
+
+bool queen_ok(const std::vector<int>& board, int row, int col)
+{
+	for (int r = 0; r < row; r++) {
+		int c = board[r];
+		if (c == col || c - col == r - row || c - col == row - r)
+			return false;
+	}
+	return true;
+}
+
+std::uint64_t nqueens_serial(std::vector<int>& board, int row)
+{
+	int n = static_cast<int>(board.size());
+	if (row == n)
+		return 1;
+	std::uint64_t count = 0;
+	for (int col = 0; col < n; col++) {
+		if (queen_ok(board, row, col)) {
+			board[row] = col;
+			count += nqueens_serial(board, row + 1);
+		}
+	}
+	return count;
+}
+
+template<typename Sched>
+std::uint64_t nqueens(Sched& sched, const std::vector<int>& board, int row)
+{
+	if (row >= nqueens_cutoff) {
+		std::vector<int> copy = board;
+		return nqueens_serial(copy, row);
+	}
+	int n = static_cast<int>(board.size());
+	std::vector<async::task<std::uint64_t>> children;
+	for (int col = 0; col < n; col++) {
+		if (queen_ok(board, row, col)) {
+			std::vector<int> child = board;
+			child[row] = col;
+			children.push_back(async::spawn(sched, [&sched, child, row] {
+				return nqueens(sched, child, row + 1);
+			}));
+		}
+	}
+	std::uint64_t count = 0;
+	for (auto& t: children)
+		count += t.get();
+	return count;
+}
+
+// Unbalanced tree search over a binomial tree: the root has a fixed number of
+// children and every other node has uts_m children with probability uts_q.
+// Node identities are derived from their parent by hashing, so the tree is the
+// same in every run. The children of a node are split in halves recursively.
+const int uts_root_children = 2000;
+const int uts_m = 8;
+const double uts_q = 0.124;
+
+std::uint64_t uts_hash(std::uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+std::uint64_t uts_child(std::uint64_t node, int i)
+{
+	return uts_hash(node * 31 + static_cast<std::uint64_t>(i) + 1);
+}
+
+int uts_num_children(std::uint64_t node)
+{
+	double p = static_cast<double>(uts_hash(node) >> 11) / 9007199254740992.0;
+	return p < uts_q ? uts_m : 0;
+}
+
+std::uint64_t uts_serial(std::uint64_t node, int children)
+{
+	std::uint64_t count = 1;
+	for (int i = 0; i < children; i++) {
+		std::uint64_t child = uts_child(node, i);
+		count += uts_serial(child, uts_num_children(child));
+	}
+	return count;
+}
+
+template<typename Sched>
+std::uint64_t uts_range(Sched& sched, std::uint64_t node, int begin, int end)
+{
+	if (end - begin == 1) {
+		std::uint64_t child = uts_child(node, begin);
+		int children = uts_num_children(child);
+		return 1 + (children ? uts_range(sched, child, 0, children) : 0);
+	}
+	int middle = begin + (end - begin) / 2;
+	std::uint64_t a;
+	auto&& t = async::local_spawn(sched, [&sched, &a, node, middle, end] {
+		a = uts_range(sched, node, middle, end);
+	});
+	std::uint64_t b = uts_range(sched, node, begin, middle);
+	t.get();
+	return a + b;
+}
+
+// Recursive matrix multiplication C += A * B on square power of two matrices
+// stored in row-major order with a common stride. The 8 quadrant products are
+// run as 2 groups of 4 with parallel_invoke, so that no 2 products running at
+// the same time write to the same quadrant of C.
+const std::size_t matmul_n = 512;
+const std::size_t matmul_cutoff = 64;
+
+void matmul_serial(const double* a, const double* b, double* c, std::size_t n, std::size_t stride)
+{
+	for (std::size_t i = 0; i < n; i++) {
+		for (std::size_t k = 0; k < n; k++) {
+			double x = a[i * stride + k];
+			for (std::size_t j = 0; j < n; j++)
+				c[i * stride + j] += x * b[k * stride + j];
+		}
+	}
+}
+
+template<typename Sched>
+void matmul(Sched& sched, const double* a, const double* b, double* c, std::size_t n, std::size_t stride)
+{
+	if (n <= matmul_cutoff) {
+		matmul_serial(a, b, c, n, stride);
+		return;
+	}
+	std::size_t h = n / 2;
+	const double *a11 = a, *a12 = a + h, *a21 = a + h * stride, *a22 = a + h * stride + h;
+	const double *b11 = b, *b12 = b + h, *b21 = b + h * stride, *b22 = b + h * stride + h;
+	double *c11 = c, *c12 = c + h, *c21 = c + h * stride, *c22 = c + h * stride + h;
+	async::parallel_invoke(sched,
+		[&] { matmul(sched, a11, b11, c11, h, stride); },
+		[&] { matmul(sched, a11, b12, c12, h, stride); },
+		[&] { matmul(sched, a21, b11, c21, h, stride); },
+		[&] { matmul(sched, a21, b12, c22, h, stride); });
+	async::parallel_invoke(sched,
+		[&] { matmul(sched, a12, b21, c11, h, stride); },
+		[&] { matmul(sched, a12, b22, c12, h, stride); },
+		[&] { matmul(sched, a22, b21, c21, h, stride); },
+		[&] { matmul(sched, a22, b22, c22, h, stride); });
+}
+
+// Matrix multiplication in the same block order as matmul(), so that the
+// floating point results are identical
+void matmul_blocked_serial(const double* a, const double* b, double* c, std::size_t n, std::size_t stride)
+{
+	if (n <= matmul_cutoff) {
+		matmul_serial(a, b, c, n, stride);
+		return;
+	}
+	std::size_t h = n / 2;
+	for (int half = 0; half < 2; half++) {
+		const double* ak = a + half * h;
+		const double* bk = b + half * h * stride;
+		matmul_blocked_serial(ak, bk, c, h, stride);
+		matmul_blocked_serial(ak, bk + h, c + h, h, stride);
+		matmul_blocked_serial(ak + h * stride, bk, c + h * stride, h, stride);
+		matmul_blocked_serial(ak + h * stride, bk + h, c + h * stride + h, h, stride);
+	}
+}
+
+// Parallel quicksort, recursing on both sides of the pivot with
+// parallel_invoke
+const std::size_t sort_n = std::size_t(1) << 22;
+const std::size_t sort_cutoff = 2048;
+
+template<typename Sched>
+void quicksort(Sched& sched, unsigned* begin, unsigned* end)
+{
+	if (static_cast<std::size_t>(end - begin) <= sort_cutoff) {
+		std::sort(begin, end);
+		return;
+	}
+	unsigned a = begin[0], b = begin[(end - begin) / 2], c = end[-1];
+	unsigned pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+	unsigned* mid1 = std::partition(begin, end, [pivot](unsigned x) { return x < pivot; });
+	unsigned* mid2 = std::partition(mid1, end, [pivot](unsigned x) { return !(pivot < x); });
+	async::parallel_invoke(sched,
+		[&sched, begin, mid1] { quicksort(sched, begin, mid1); },
+		[&sched, mid2, end] { quicksort(sched, mid2, end); });
+}
+
+// Sparse LU factorization of a block matrix in which some blocks are empty,
+// following the BOTS sparselu kernel. Each step factorizes a diagonal block,
+// then updates its row and column and finally the trailing submatrix, with one
+// task per block in each phase.
+const std::size_t lu_blocks = 24;
+const std::size_t lu_block_size = 32;
+
+typedef std::vector<std::unique_ptr<double[]>> lu_matrix;
+
+lu_matrix lu_input()
+{
+	const std::size_t nb = lu_blocks, bs = lu_block_size;
+	lu_matrix m(nb * nb);
+	std::uint64_t seed = 1325;
+	for (std::size_t ii = 0; ii < nb; ii++) {
+		for (std::size_t jj = 0; jj < nb; jj++) {
+			// Same sparsity pattern as BOTS: keep the diagonals and some of
+			// the other blocks
+			bool empty = (ii < jj && ii % 3 != 0) || (ii > jj && jj % 3 != 0) || ii % 2 == 1 || jj % 2 == 1;
+			if (ii == jj || ii == jj - 1 || ii - 1 == jj)
+				empty = false;
+			if (empty)
+				continue;
+			m[ii * nb + jj].reset(new double[bs * bs]);
+			for (std::size_t k = 0; k < bs * bs; k++) {
+				seed = (3125 * seed) % 65536;
+				m[ii * nb + jj][k] = (seed - 32768.0) / 16384.0;
+			}
+
+			// Make the matrix diagonally dominant so that factorizing it
+			// without pivoting is stable
+			if (ii == jj) {
+				for (std::size_t k = 0; k < bs; k++)
+					m[ii * nb + jj][k * bs + k] += 2.0 * static_cast<double>(nb * bs);
+			}
+		}
+	}
+	return m;
+}
+
+void lu0(double* diag)
+{
+	const std::size_t bs = lu_block_size;
+	for (std::size_t k = 0; k < bs; k++) {
+		for (std::size_t i = k + 1; i < bs; i++) {
+			diag[i * bs + k] /= diag[k * bs + k];
+			for (std::size_t j = k + 1; j < bs; j++)
+				diag[i * bs + j] -= diag[i * bs + k] * diag[k * bs + j];
+		}
+	}
+}
+
+void lu_fwd(const double* diag, double* col)
+{
+	const std::size_t bs = lu_block_size;
+	for (std::size_t k = 0; k < bs; k++) {
+		for (std::size_t i = k + 1; i < bs; i++) {
+			for (std::size_t j = 0; j < bs; j++)
+				col[i * bs + j] -= diag[i * bs + k] * col[k * bs + j];
+		}
+	}
+}
+
+void lu_bdiv(const double* diag, double* row)
+{
+	const std::size_t bs = lu_block_size;
+	for (std::size_t i = 0; i < bs; i++) {
+		for (std::size_t k = 0; k < bs; k++) {
+			row[i * bs + k] /= diag[k * bs + k];
+			for (std::size_t j = k + 1; j < bs; j++)
+				row[i * bs + j] -= row[i * bs + k] * diag[k * bs + j];
+		}
+	}
+}
+
+void lu_bmod(const double* row, const double* col, double* inner)
+{
+	const std::size_t bs = lu_block_size;
+	for (std::size_t i = 0; i < bs; i++) {
+		for (std::size_t k = 0; k < bs; k++) {
+			double x = row[i * bs + k];
+			for (std::size_t j = 0; j < bs; j++)
+				inner[i * bs + j] -= x * col[k * bs + j];
+		}
+	}
+}
+
+// Update a block of the trailing submatrix, allocating it if it was empty
+void lu_update(lu_matrix& m, std::size_t ii, std::size_t jj, std::size_t kk)
+{
+	const std::size_t nb = lu_blocks, bs = lu_block_size;
+	auto& inner = m[ii * nb + jj];
+	if (!inner) {
+		inner.reset(new double[bs * bs]);
+		std::fill(inner.get(), inner.get() + bs * bs, 0.0);
+	}
+	lu_bmod(m[ii * nb + kk].get(), m[kk * nb + jj].get(), inner.get());
+}
+
+void sparselu_serial(lu_matrix& m)
+{
+	const std::size_t nb = lu_blocks;
+	for (std::size_t kk = 0; kk < nb; kk++) {
+		lu0(m[kk * nb + kk].get());
+		for (std::size_t jj = kk + 1; jj < nb; jj++) {
+			if (m[kk * nb + jj])
+				lu_fwd(m[kk * nb + kk].get(), m[kk * nb + jj].get());
+		}
+		for (std::size_t ii = kk + 1; ii < nb; ii++) {
+			if (m[ii * nb + kk])
+				lu_bdiv(m[kk * nb + kk].get(), m[ii * nb + kk].get());
+		}
+		for (std::size_t ii = kk + 1; ii < nb; ii++) {
+			if (!m[ii * nb + kk])
+				continue;
+			for (std::size_t jj = kk + 1; jj < nb; jj++) {
+				if (m[kk * nb + jj])
+					lu_update(m, ii, jj, kk);
+			}
+		}
+	}
+}
+
+template<typename Sched>
+void sparselu(Sched& sched, lu_matrix& m)
+{
+	const std::size_t nb = lu_blocks;
+	std::vector<async::task<void>> tasks;
+	for (std::size_t kk = 0; kk < nb; kk++) {
+		double* diag = m[kk * nb + kk].get();
+		lu0(diag);
+		for (std::size_t jj = kk + 1; jj < nb; jj++) {
+			if (double* col = m[kk * nb + jj].get())
+				tasks.push_back(async::spawn(sched, [diag, col] { lu_fwd(diag, col); }));
+		}
+		for (std::size_t ii = kk + 1; ii < nb; ii++) {
+			if (double* row = m[ii * nb + kk].get())
+				tasks.push_back(async::spawn(sched, [diag, row] { lu_bdiv(diag, row); }));
+		}
+		async::when_all(tasks).get();
+		tasks.clear();
+
+		for (std::size_t ii = kk + 1; ii < nb; ii++) {
+			if (!m[ii * nb + kk])
+				continue;
+			for (std::size_t jj = kk + 1; jj < nb; jj++) {
+				if (m[kk * nb + jj])
+					tasks.push_back(async::spawn(sched, [&m, ii, jj, kk] { lu_update(m, ii, jj, kk); }));
+			}
+		}
+		async::when_all(tasks).get();
+		tasks.clear();
+	}
+}
+
+double lu_checksum(const lu_matrix& m)
+{
+	double sum = 0;
+	for (const auto& block: m) {
+		if (block) {
+			for (std::size_t k = 0; k < lu_block_size * lu_block_size; k++)
+				sum += block[k];
+		}
+	}
+	return sum;
+}
+
+// A kernel prepares its input outside of the timed region, runs, and returns
+// a checksum of its result which must match the serial version. Both the
+// serial and parallel versions run on prepared input.
+struct kernel {
+	const char* name;
+	std::function<double()> serial;
+	std::function<void()> prepare;
+	std::function<double(async::threadpool_scheduler&)> run;
+};
+
+std::vector<double> matmul_a, matmul_b, matmul_c;
+std::vector<unsigned> sort_data;
+lu_matrix lu_data;
+
+void matmul_prepare()
+{
+	const std::size_t n = matmul_n;
+	matmul_a.resize(n * n);
+	matmul_b.resize(n * n);
+	for (std::size_t i = 0; i < n * n; i++) {
+		matmul_a[i] = static_cast<double>(i % 7) - 3.0;
+		matmul_b[i] = static_cast<double>(i % 5) - 2.0;
+	}
+	matmul_c.assign(n * n, 0.0);
+}
+
+double matmul_checksum()
+{
+	double sum = 0;
+	for (double x: matmul_c)
+		sum += x;
+	return sum;
+}
+
+void sort_prepare()
+{
+	std::mt19937 gen(7);
+	sort_data.resize(sort_n);
+	for (auto& x: sort_data)
+		x = gen();
+}
+
+double sort_checksum()
+{
+	if (!std::is_sorted(sort_data.begin(), sort_data.end()))
+		return -1;
+	double sum = 0;
+	for (std::size_t i = 0; i < sort_data.size(); i += 1024)
+		sum += sort_data[i];
+	return sum;
+}
+
+std::vector<kernel> make_kernels()
+{
+	std::vector<kernel> kernels;
+	kernels.push_back(kernel{"fib",
+		[] { return static_cast<double>(fib_serial(fib_n)); },
+		[] {},
+		[](async::threadpool_scheduler& sched) { return static_cast<double>(fib(sched, fib_n)); }});
+	kernels.push_back(kernel{"nqueens",
+		[] { std::vector<int> board(nqueens_n); return static_cast<double>(nqueens_serial(board, 0)); },
+		[] {},
+		[](async::threadpool_scheduler& sched) { return static_cast<double>(nqueens(sched, std::vector<int>(nqueens_n), 0)); }});
+	kernels.push_back(kernel{"uts",
+		[] { return static_cast<double>(uts_serial(0, uts_root_children)); },
+		[] {},
+		[](async::threadpool_scheduler& sched) { return static_cast<double>(1 + uts_range(sched, 0, 0, uts_root_children)); }});
+	kernels.push_back(kernel{"matmul",
+		[] { matmul_blocked_serial(matmul_a.data(), matmul_b.data(), matmul_c.data(), matmul_n, matmul_n); return matmul_checksum(); },
+		matmul_prepare,
+		[](async::threadpool_scheduler& sched) { matmul(sched, matmul_a.data(), matmul_b.data(), matmul_c.data(), matmul_n, matmul_n); return matmul_checksum(); }});
+	kernels.push_back(kernel{"sort",
+		[] { std::sort(sort_data.begin(), sort_data.end()); return sort_checksum(); },
+		sort_prepare,
+		[](async::threadpool_scheduler& sched) { quicksort(sched, sort_data.data(), sort_data.data() + sort_data.size()); return sort_checksum(); }});
+	kernels.push_back(kernel{"sparselu",
+		[] { sparselu_serial(lu_data); return lu_checksum(lu_data); },
+		[] { lu_data = lu_input(); },
+		[](async::threadpool_scheduler& sched) { sparselu(sched, lu_data); return lu_checksum(lu_data); }});
+	return kernels;
+}
+
+typedef std::chrono::steady_clock clock_type;
+
+double seconds_since(clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+std::vector<std::size_t> parse_thread_list(const char* list)
+{
+	std::vector<std::size_t> out;
+	while (*list) {
+		char* end;
+		unsigned long n = std::strtoul(list, &end, 10);
+		if (end == list || n == 0)
+			break;
+		out.push_back(n);
+		list = *end == ',' ? end + 1 : end;
+	}
+	return out;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	std::string filter, csv;
+	int repetitions = 3;
+	std::vector<std::size_t> threads;
+	for (int i = 1; i < argc; i++) {
+		const char* a = argv[i];
+		if (std::strncmp(a, "--kernel=", 9) == 0)
+			filter = a + 9;
+		else if (std::strncmp(a, "--repetitions=", 14) == 0)
+			repetitions = std::max(1, std::atoi(a + 14));
+		else if (std::strncmp(a, "--threads=", 10) == 0)
+			threads = parse_thread_list(a + 10);
+		else if (std::strncmp(a, "--max-threads=", 14) == 0) {
+			threads.clear();
+			for (int n = 1; n <= std::atoi(a + 14); n++)
+				threads.push_back(n);
+		} else if (std::strncmp(a, "--csv=", 6) == 0)
+			csv = a + 6;
+		else {
+			std::fprintf(stderr, "usage: %s [--kernel=NAME] [--repetitions=N] [--threads=1,2,...] [--max-threads=N] [--csv=FILE]\n", argv[0]);
+			return a[0] == '-' && a[1] == 'h' ? 0 : 1;
+		}
+	}
+	if (threads.empty()) {
+		for (std::size_t n = 1; n <= async::hardware_concurrency(); n++)
+			threads.push_back(n);
+	}
+
+	std::FILE* out = csv.empty() ? stdout : std::fopen(csv.c_str(), "w");
+	if (!out) {
+		std::perror(csv.c_str());
+		return 1;
+	}
+	std::fprintf(out, "kernel,threads,seconds,min_seconds,serial_seconds,speedup,efficiency\n");
+
+	int status = 0;
+	for (const kernel& k: make_kernels()) {
+		if (!filter.empty() && filter != k.name)
+			continue;
+
+		// The serial version gives the expected result and a baseline time
+		k.prepare();
+		auto start = clock_type::now();
+		double expected = k.serial();
+		double serial_time = seconds_since(start);
+
+		double base_time = 0;
+		for (std::size_t n: threads) {
+			async::threadpool_scheduler sched(n);
+			std::vector<double> times;
+			for (int r = 0; r < repetitions; r++) {
+				k.prepare();
+				start = clock_type::now();
+				double result = k.run(sched);
+				times.push_back(seconds_since(start));
+				if (result != expected) {
+					std::fprintf(stderr, "%s: wrong result with %zu threads: %.17g, expected %.17g\n", k.name, n, result, expected);
+					status = 1;
+				}
+			}
+			std::sort(times.begin(), times.end());
+			double median = times[times.size() / 2];
+
+			// Speedup is relative to the first thread count, normally 1. If
+			// the list starts higher, perfect scaling up to it is assumed.
+			if (base_time == 0)
+				base_time = median * threads.front();
+			double speedup = base_time / median;
+			std::fprintf(out, "%s,%zu,%.6f,%.6f,%.6f,%.3f,%.3f\n", k.name, n, median, times.front(), serial_time, speedup, speedup / n);
+			std::fflush(out);
+		}
+	}
+
+	if (out != stdout)
+		std::fclose(out);
+	return status;
+}
@@ -0,0 +1,246 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Open-loop latency benchmark. External threads submit tasks to a thread pool
+// at a fixed arrival rate which doesn't depend on how fast tasks complete, so
+// queueing delays show up in the measured latencies instead of slowing down
+// the load. Latencies are measured from the intended arrival time of each
+// task, which avoids hiding delays in the submitting thread itself.
+// Each task busy-waits for a fixed service time. The arrival rate is derived
+// from the target utilisation of the pool.
+
+#include <async++.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+std::uint64_t ns_between(clock_type::time_point a, clock_type::time_point b)
+{
+	return b > a ? static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count()) : 0;
+}
+
+struct options {
+	std::size_t threads = async::hardware_concurrency();
+	std::size_t submitters = 1;
+	double service_us = 10;
+	double duration = 1;
+	double warmup = 0.1;
+	bool poisson = true;
+	std::vector<double> utilisations = {0.1, 0.3, 0.5, 0.7, 0.8, 0.9, 0.95};
+	std::string csv;
+};
+
+// Latency histograms, one per worker thread of the pool plus one for tasks
+// which somehow run outside of it
+struct latency_recorder {
+	async::threadpool_scheduler& sched;
+	std::vector<async::task_stats_histogram> start, finish;
+	std::mutex outside_lock;
+
+	latency_recorder(async::threadpool_scheduler& sched)
+		: sched(sched), start(sched.num_threads() + 1), finish(sched.num_threads() + 1) {}
+
+	void record(std::uint64_t start_ns, std::uint64_t finish_ns)
+	{
+		std::size_t index = sched.current_thread_index();
+		if (index < sched.num_threads()) {
+			start[index].record(start_ns);
+			finish[index].record(finish_ns);
+		} else {
+			std::lock_guard<std::mutex> lock(outside_lock);
+			start.back().record(start_ns);
+			finish.back().record(finish_ns);
+		}
+	}
+};
+
+struct level_result {
+	double utilisation;
+	double rate;
+	double achieved_rate;
+	async::task_stats_histogram start, finish;
+};
+
+level_result run_level(async::threadpool_scheduler& sched, const options& opts, double utilisation)
+{
+	const auto service = std::chrono::nanoseconds(static_cast<std::int64_t>(opts.service_us * 1000));
+	const double rate = utilisation * static_cast<double>(opts.threads) / (opts.service_us * 1e-6);
+	const double submitter_rate = rate / static_cast<double>(opts.submitters);
+
+	latency_recorder recorder(sched);
+	std::atomic<std::uint64_t> submitted(0), completed(0);
+	const auto begin = clock_type::now() + std::chrono::milliseconds(10);
+	const auto record_from = begin + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(opts.warmup));
+	const auto end = record_from + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(opts.duration));
+
+	std::vector<std::thread> submitters;
+	for (std::size_t s = 0; s < opts.submitters; s++) {
+		submitters.emplace_back([&, s] {
+			std::mt19937_64 gen(s + 1);
+			std::exponential_distribution<double> poisson(submitter_rate);
+			const double interval = 1.0 / submitter_rate;
+
+			// Spread the submitters over the first interval
+			double offset = interval * static_cast<double>(s) / static_cast<double>(opts.submitters);
+			auto intended = begin + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(offset));
+			while (intended < end) {
+				// Wait for the arrival time, but submit immediately if we are
+				// running behind so that the load stays the same
+				while (clock_type::now() < intended)
+					std::this_thread::yield();
+
+				bool record = intended >= record_from;
+				submitted.fetch_add(1, std::memory_order_relaxed);
+				async::spawn(sched, [&recorder, &completed, intended, service, record] {
+					auto started = clock_type::now();
+					while (clock_type::now() - started < service) {}
+					auto finished = clock_type::now();
+					if (record)
+						recorder.record(ns_between(intended, started), ns_between(intended, finished));
+					completed.fetch_add(1, std::memory_order_release);
+				});
+
+				double gap = opts.poisson ? poisson(gen) : interval;
+				intended += std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(gap));
+			}
+		});
+	}
+	for (auto& t: submitters)
+		t.join();
+	while (completed.load(std::memory_order_acquire) != submitted.load(std::memory_order_relaxed))
+		std::this_thread::yield();
+
+	level_result result;
+	result.utilisation = utilisation;
+	result.rate = rate;
+	for (std::size_t i = 0; i < recorder.start.size(); i++) {
+		result.start.merge(recorder.start[i]);
+		result.finish.merge(recorder.finish[i]);
+	}
+	result.achieved_rate = static_cast<double>(result.start.count()) / opts.duration;
+	return result;
+}
+
+std::vector<double> parse_list(const char* list)
+{
+	std::vector<double> out;
+	while (*list) {
+		char* end;
+		double x = std::strtod(list, &end);
+		if (end == list)
+			break;
+		out.push_back(x);
+		list = *end == ',' ? end + 1 : end;
+	}
+	return out;
+}
+
+double us(std::uint64_t ns)
+{
+	return static_cast<double>(ns) / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	options opts;
+	for (int i = 1; i < argc; i++) {
+		const char* a = argv[i];
+		if (std::strncmp(a, "--threads=", 10) == 0)
+			opts.threads = std::max(1, std::atoi(a + 10));
+		else if (std::strncmp(a, "--submitters=", 13) == 0)
+			opts.submitters = std::max(1, std::atoi(a + 13));
+		else if (std::strncmp(a, "--service-us=", 13) == 0)
+			opts.service_us = std::atof(a + 13);
+		else if (std::strncmp(a, "--duration=", 11) == 0)
+			opts.duration = std::atof(a + 11);
+		else if (std::strncmp(a, "--warmup=", 9) == 0)
+			opts.warmup = std::atof(a + 9);
+		else if (std::strcmp(a, "--arrival=poisson") == 0)
+			opts.poisson = true;
+		else if (std::strcmp(a, "--arrival=constant") == 0)
+			opts.poisson = false;
+		else if (std::strncmp(a, "--utilisation=", 14) == 0)
+			opts.utilisations = parse_list(a + 14);
+		else if (std::strncmp(a, "--csv=", 6) == 0)
+			opts.csv = a + 6;
+		else {
+			std::fprintf(stderr, "usage: %s [--threads=N] [--submitters=N] [--service-us=US] [--duration=SECONDS] [--warmup=SECONDS]\n"
+			             "       [--arrival=poisson|constant] [--utilisation=0.1,0.5,...] [--csv=FILE]\n", argv[0]);
+			return a[0] == '-' && a[1] == 'h' ? 0 : 1;
+		}
+	}
+	if (opts.service_us <= 0 || opts.duration <= 0 || opts.utilisations.empty()) {
+		std::fprintf(stderr, "invalid options\n");
+		return 1;
+	}
+
+	std::FILE* csv = nullptr;
+	if (!opts.csv.empty()) {
+		csv = std::fopen(opts.csv.c_str(), "w");
+		if (!csv) {
+			std::perror(opts.csv.c_str());
+			return 1;
+		}
+		std::fprintf(csv, "threads,submitters,arrival,service_us,utilisation,rate,achieved_rate,tasks,"
+		                  "start_p50_us,start_p99_us,start_p999_us,start_max_us,finish_p50_us,finish_p99_us,finish_p999_us,finish_max_us\n");
+	}
+
+	std::printf("threads=%zu submitters=%zu service=%gus arrival=%s duration=%gs\n",
+	            opts.threads, opts.submitters, opts.service_us, opts.poisson ? "poisson" : "constant", opts.duration);
+	std::printf("%6s %10s %9s | %-35s | %-35s\n", "", "", "", "schedule to start (us)", "schedule to finish (us)");
+	std::printf("%6s %10s %9s | %8s %8s %8s %8s | %8s %8s %8s %8s\n", "util", "rate/s", "tasks",
+	            "p50", "p99", "p99.9", "max", "p50", "p99", "p99.9", "max");
+
+	async::threadpool_scheduler sched(opts.threads);
+	for (double u: opts.utilisations) {
+		level_result r = run_level(sched, opts, u);
+		std::printf("%6.2f %10.0f %9llu | %8.1f %8.1f %8.1f %8.1f | %8.1f %8.1f %8.1f %8.1f\n",
+		            r.utilisation, r.rate, static_cast<unsigned long long>(r.start.count()),
+		            us(r.start.percentile(50)), us(r.start.percentile(99)), us(r.start.percentile(99.9)), us(r.start.max()),
+		            us(r.finish.percentile(50)), us(r.finish.percentile(99)), us(r.finish.percentile(99.9)), us(r.finish.max()));
+		std::fflush(stdout);
+		if (csv) {
+			std::fprintf(csv, "%zu,%zu,%s,%g,%g,%.1f,%.1f,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+			             opts.threads, opts.submitters, opts.poisson ? "poisson" : "constant", opts.service_us,
+			             r.utilisation, r.rate, r.achieved_rate, static_cast<unsigned long long>(r.start.count()),
+			             us(r.start.percentile(50)), us(r.start.percentile(99)), us(r.start.percentile(99.9)), us(r.start.max()),
+			             us(r.finish.percentile(50)), us(r.finish.percentile(99)), us(r.finish.percentile(99.9)), us(r.finish.max()));
+		}
+	}
+
+	if (csv)
+		std::fclose(csv);
+	return 0;
+}
@@ -0,0 +1,237 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Microbenchmarks of the task runtime: task creation, continuations, task
+// combinators, event wakeups and submission to the thread pool.
+
+#include "bench.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Wait for a counter to reach a value, yielding so that the thread pool can
+// make progress on machines with few cores
+void wait_until(const std::atomic<std::size_t>& counter, std::size_t value)
+{
+	while (counter.load(std::memory_order_acquire) < value)
+		std::this_thread::yield();
+}
+
+} // namespace
+
+// Round trip of spawning a task from an external thread and waiting for it
+BENCH(spawn_get)
+{
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(async::spawn([] { return 1; }).get());
+}
+
+// Same with the inline scheduler, which only measures task allocation and
+// bookkeeping
+BENCH(spawn_get_inline)
+{
+	for (std::size_t i = 0; i < state.iterations(); i++)
+		bench::do_not_optimize(async::spawn(async::inline_scheduler(), [] { return 1; }).get());
+}
+
+// Spawning from a worker thread, which pushes to the worker's own queue
+BENCH(spawn_get_worker)
+{
+	std::size_t n = state.iterations();
+	async::spawn([n] {
+		for (std::size_t i = 0; i < n; i++)
+			bench::do_not_optimize(async::spawn([] { return 1; }).get());
+	}).get();
+}
+
+// local_spawn from a worker thread, which avoids the heap allocation
+BENCH(local_spawn_worker)
+{
+	std::size_t n = state.iterations();
+	async::spawn([n] {
+		for (std::size_t i = 0; i < n; i++) {
+			auto&& t = async::local_spawn([] { return 1; });
+			bench::do_not_optimize(t.get());
+		}
+	}).get();
+}
+
+// Throughput of a chain of continuations which is built before its root is
+// completed, so that each continuation is scheduled by the previous one
+BENCH_ARGS(then_chain, 1, 16, 256)
+{
+	std::size_t length = state.arg();
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::event_task<int> root;
+		async::task<int> t = root.get_task();
+		for (std::size_t j = 0; j < length; j++)
+			t = t.then([](int x) { return x + 1; });
+		root.set(0);
+		bench::do_not_optimize(t.get());
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * length));
+}
+
+// Fan-out of a shared_task to many continuations, joined with when_all
+BENCH_ARGS(shared_task_fanout, 16, 256)
+{
+	std::size_t width = state.arg();
+	std::vector<async::task<int>> conts;
+	conts.reserve(width);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::event_task<int> root;
+		async::shared_task<int> shared = root.get_task().share();
+		for (std::size_t j = 0; j < width; j++)
+			conts.push_back(shared.then([](int x) { return x + 1; }));
+		root.set(1);
+		bench::do_not_optimize(async::when_all(conts).get());
+		conts.clear();
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * width));
+}
+
+// Waiting for N tasks with when_all
+BENCH_ARGS(when_all, 1, 16, 256)
+{
+	std::size_t count = state.arg();
+	std::vector<async::task<void>> tasks;
+	tasks.reserve(count);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (std::size_t j = 0; j < count; j++)
+			tasks.push_back(async::spawn([] {}));
+		async::when_all(tasks).get();
+		tasks.clear();
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * count));
+}
+
+// Waiting for the first of N tasks with when_any. The remaining tasks are
+// waited for as well so that iterations don't overlap.
+BENCH_ARGS(when_any, 1, 16, 256)
+{
+	std::size_t count = state.arg();
+	std::vector<async::task<void>> tasks;
+	tasks.reserve(count);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (std::size_t j = 0; j < count; j++)
+			tasks.push_back(async::spawn([] {}));
+		auto result = async::when_any(tasks).get();
+		for (auto& t: result.tasks)
+			t.get();
+		tasks.clear();
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * count));
+}
+
+// Latency from event_task::set() until a thread blocked in get() on the
+// event's task has woken up and acknowledged it
+BENCH(event_wake_blocked)
+{
+	std::size_t n = state.iterations();
+	state.pause_timing();
+	std::vector<async::event_task<std::size_t>> events(n);
+	std::vector<async::task<std::size_t>> tasks;
+	tasks.reserve(n);
+	for (auto& e: events)
+		tasks.push_back(e.get_task());
+	std::atomic<std::size_t> ack(0);
+	std::thread waiter([&tasks, &ack] {
+		for (auto& t: tasks)
+			ack.store(t.get() + 1, std::memory_order_release);
+	});
+	state.resume_timing();
+
+	for (std::size_t i = 0; i < n; i++) {
+		events[i].set(i);
+		wait_until(ack, i + 1);
+	}
+
+	state.pause_timing();
+	waiter.join();
+	state.resume_timing();
+}
+
+// Latency from event_task::set() until a continuation of the event's task has
+// run in the thread pool
+BENCH(event_wake_continuation)
+{
+	std::size_t n = state.iterations();
+	state.pause_timing();
+	std::atomic<std::size_t> ack(0);
+	std::vector<async::event_task<std::size_t>> events(n);
+	std::vector<async::task<void>> conts;
+	conts.reserve(n);
+	for (auto& e: events) {
+		conts.push_back(e.get_task().then([&ack](std::size_t i) {
+			ack.store(i + 1, std::memory_order_release);
+		}));
+	}
+	state.resume_timing();
+
+	for (std::size_t i = 0; i < n; i++) {
+		events[i].set(i);
+		wait_until(ack, i + 1);
+	}
+
+	state.pause_timing();
+	async::when_all(conts).get();
+	state.resume_timing();
+}
+
+// Throughput of submitting batches of empty tasks to the thread pool from a
+// thread outside of it, which goes through the pool's shared queue
+BENCH_ARGS(submit_external, 1024)
+{
+	std::size_t batch = state.arg();
+	std::atomic<std::size_t> done(0);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		for (std::size_t j = 0; j < batch; j++) {
+			async::spawn([&done] {
+				done.fetch_add(1, std::memory_order_release);
+			});
+		}
+		wait_until(done, (i + 1) * batch);
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * batch));
+}
+
+// Same but submitted from a worker thread, which pushes to its own queue from
+// where other workers steal
+BENCH_ARGS(submit_worker, 1024)
+{
+	std::size_t batch = state.arg();
+	std::atomic<std::size_t> done(0);
+	for (std::size_t i = 0; i < state.iterations(); i++) {
+		async::spawn([&done, batch] {
+			for (std::size_t j = 0; j < batch; j++) {
+				async::spawn([&done] {
+					done.fetch_add(1, std::memory_order_release);
+				});
+			}
+		});
+		wait_until(done, (i + 1) * batch);
+	}
+	state.set_items_processed(static_cast<double>(state.iterations() * batch));
+}
+
+BENCH_MAIN()
@@ -22,18 +22,23 @@
 #define ASYNCXX_H_
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <exception>
 #include <functional>
 #include <iterator>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -138,6 +143,11 @@ class event_task;
 #include "async++/ref_count.h"
 #include "async++/scheduler_fwd.h"
 #include "async++/continuation_vector.h"
+#include "async++/task_stats.h"
+#include "async++/task_profile.h"
+#include "async++/work_span.h"
+#include "async++/usdt.h"
+#include "async++/hooks.h"
 #include "async++/task_base.h"
 #include "async++/scheduler.h"
 #include "async++/task.h"
@@ -148,6 +158,15 @@ class event_task;
 #include "async++/parallel_invoke.h"
 #include "async++/parallel_for.h"
 #include "async++/parallel_reduce.h"
+#include "async++/parallel_scan.h"
+#include "async++/parallel_merge.h"
+#include "async++/parallel_sort.h"
+#include "async++/parallel_partition.h"
+#include "async++/parallel_find.h"
+#include "async++/parallel_do.h"
+#include "async++/parallel_region.h"
+#include "async++/combinable.h"
+#include "async++/execution.h"
 
 #ifndef LIBASYNC_STATIC
 #if defined(__GNUC__) && !defined(_WIN32)
@@ -0,0 +1,228 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Storage for one thread's copy of a combinable value. Each slot is aligned to
+// a cache line so that threads updating their own copy don't cause false
+// sharing between them.
+template<typename T>
+struct LIBASYNC_CACHELINE_ALIGN combinable_slot {
+	typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+	bool constructed;
+
+	combinable_slot()
+		: constructed(false) {}
+	~combinable_slot()
+	{
+		if (constructed)
+			get().~T();
+	}
+
+	T& get()
+	{
+		return *reinterpret_cast<T*>(&storage);
+	}
+	void destroy()
+	{
+		if (constructed) {
+			get().~T();
+			constructed = false;
+		}
+	}
+};
+
+// Slot for a thread which is not a worker of the thread pool. These are kept in
+// a lock-free singly-linked list since there are usually very few of them.
+template<typename T>
+struct combinable_foreign_slot: public combinable_slot<T> {
+	std::thread::id owner;
+	combinable_foreign_slot* next;
+
+	explicit combinable_foreign_slot(std::thread::id owner)
+		: owner(owner), next(nullptr) {}
+
+	// Use aligned memory allocation
+	static void* operator new(std::size_t size)
+	{
+		return aligned_alloc(size, LIBASYNC_CACHELINE_SIZE);
+	}
+	static void operator delete(void* ptr)
+	{
+		aligned_free(ptr);
+	}
+};
+
+} // namespace detail
+
+// Container holding one copy of a value for each thread which accesses it. The
+// copies are indexed by the worker id of the thread in a threadpool_scheduler,
+// so a parallel loop running on that pool can accumulate into a thread-local
+// value without any synchronization and merge the values at the end. Threads
+// outside the pool (such as the one which started the loop) get their own copy
+// which is looked up by thread id.
+template<typename T>
+class combinable {
+	threadpool_scheduler* sched;
+	std::function<T()> init;
+
+	// Slots for worker threads, indexed by thread id
+	detail::aligned_array<detail::combinable_slot<T>> slots;
+
+	// Slots for threads outside the pool
+	std::atomic<detail::combinable_foreign_slot<T>*> foreign_slots;
+
+	// Find the slot of a thread outside the pool, creating it if necessary. A
+	// slot is only ever added by the thread that owns it, so there is no risk
+	// of two threads adding a slot for the same thread id.
+	detail::combinable_slot<T>& get_foreign_slot()
+	{
+		std::thread::id current_thread = std::this_thread::get_id();
+		detail::combinable_foreign_slot<T>* head = foreign_slots.load(std::memory_order_acquire);
+		for (detail::combinable_foreign_slot<T>* p = head; p; p = p->next) {
+			if (p->owner == current_thread)
+				return *p;
+		}
+
+		// Not found, push a new slot to the front of the list
+		detail::combinable_foreign_slot<T>* slot = new detail::combinable_foreign_slot<T>(current_thread);
+		slot->next = head;
+		while (!foreign_slots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_acquire)) {}
+		return *slot;
+	}
+
+	detail::combinable_slot<T>& get_slot()
+	{
+		std::size_t index = sched->current_thread_index();
+		if (index < slots.size())
+			return slots[index];
+		else
+			return get_foreign_slot();
+	}
+
+	// Call a function on each slot which contains a value
+	template<typename Func>
+	void for_each_slot(const Func& func)
+	{
+		for (std::size_t i = 0; i < slots.size(); i++) {
+			if (slots[i].constructed)
+				func(slots[i].get());
+		}
+		for (detail::combinable_foreign_slot<T>* p = foreign_slots.load(std::memory_order_acquire); p; p = p->next) {
+			if (p->constructed)
+				func(p->get());
+		}
+	}
+
+public:
+	// Create a combinable whose thread-local values are value-initialized
+	explicit combinable(threadpool_scheduler& sched = ::async::default_threadpool_scheduler())
+		: sched(std::addressof(sched)), init([] {return T();}), slots(sched.num_threads()), foreign_slots(nullptr) {}
+
+	// Create a combinable whose thread-local values are created by calling
+	// the given function.
+	template<typename Func>
+	combinable(threadpool_scheduler& sched, Func&& f)
+		: sched(std::addressof(sched)), init(std::forward<Func>(f)), slots(sched.num_threads()), foreign_slots(nullptr) {}
+	template<typename Func, typename = typename std::enable_if<detail::is_callable<typename std::decay<Func>::type()>::value>::type>
+	explicit combinable(Func&& f)
+		: combinable(::async::default_threadpool_scheduler(), std::forward<Func>(f)) {}
+
+	// Non-copyable and non-movable
+	combinable(const combinable&) = delete;
+	combinable& operator=(const combinable&) = delete;
+
+	~combinable()
+	{
+		detail::combinable_foreign_slot<T>* p = foreign_slots.load(std::memory_order_relaxed);
+		while (p) {
+			detail::combinable_foreign_slot<T>* next = p->next;
+			delete p;
+			p = next;
+		}
+	}
+
+	// Get the value for the calling thread, creating it if this thread has
+	// not accessed it before. The exists parameter is set to whether the
+	// value already existed.
+	T& local(bool& exists)
+	{
+		detail::combinable_slot<T>& slot = get_slot();
+		exists = slot.constructed;
+		if (!exists) {
+			new(&slot.storage) T(init());
+			slot.constructed = true;
+		}
+		return slot.get();
+	}
+	T& local()
+	{
+		bool exists;
+		return local(exists);
+	}
+
+	// Destroy all thread-local values. This must not be called concurrently
+	// with any other function on this object.
+	void clear()
+	{
+		for (std::size_t i = 0; i < slots.size(); i++)
+			slots[i].destroy();
+		for (detail::combinable_foreign_slot<T>* p = foreign_slots.load(std::memory_order_relaxed); p; p = p->next)
+			p->destroy();
+	}
+
+	// Merge all thread-local values using the given binary function. If no
+	// thread has accessed the object then a newly initialized value is
+	// returned. This must not be called concurrently with local().
+	template<typename Func>
+	T combine(const Func& func)
+	{
+		T* first = nullptr;
+		for_each_slot([&first](T& value) {
+			if (!first)
+				first = std::addressof(value);
+		});
+		if (!first)
+			return init();
+
+		T result(*first);
+		for_each_slot([first, &result, &func](T& value) {
+			if (std::addressof(value) != first)
+				result = func(std::move(result), value);
+		});
+		return result;
+	}
+
+	// Call a function on each thread-local value. This must not be called
+	// concurrently with local().
+	template<typename Func>
+	void combine_each(const Func& func)
+	{
+		for_each_slot(func);
+	}
+};
+
+} // namespace async
@@ -0,0 +1,285 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace execution {
+
+// Execution policy which runs an algorithm on a specific scheduler
+template<typename Sched>
+class parallel_policy {
+	Sched* sched;
+
+public:
+	explicit parallel_policy(Sched& sched)
+		: sched(&sched) {}
+
+	Sched& scheduler() const
+	{
+		return *sched;
+	}
+};
+
+// Type of the par policy, which runs algorithms on the default scheduler.
+// par(sched) creates a policy which uses the given scheduler instead.
+struct parallel_default_policy {
+	template<typename Sched>
+	parallel_policy<Sched> operator()(Sched& sched) const
+	{
+		return parallel_policy<Sched>(sched);
+	}
+};
+const parallel_default_policy par = {};
+
+// Detect whether a type is an execution policy
+template<typename T>
+struct is_execution_policy: public std::false_type {};
+template<typename Sched>
+struct is_execution_policy<parallel_policy<Sched>>: public std::true_type {};
+template<>
+struct is_execution_policy<parallel_default_policy>: public std::true_type {};
+
+} // namespace execution
+
+namespace detail {
+
+// Get the scheduler that an execution policy runs on
+inline default_scheduler_type& policy_scheduler(const execution::parallel_default_policy&)
+{
+	return ::async::default_scheduler();
+}
+template<typename Sched>
+Sched& policy_scheduler(const execution::parallel_policy<Sched>& policy)
+{
+	return policy.scheduler();
+}
+
+// Return type of an algorithm taking an execution policy
+template<typename Policy, typename T>
+struct enable_if_policy: public std::enable_if<execution::is_execution_policy<typename std::decay<Policy>::type>::value, T> {};
+
+// Partial result of a reduction without an identity value, as required by
+// the standard algorithms which only use their initial value once. Leaves
+// start out empty and take their first mapped value as is.
+template<typename T>
+class policy_partial {
+	typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+	bool full;
+
+public:
+	policy_partial()
+		: full(false) {}
+	explicit policy_partial(T&& value)
+		: full(true)
+	{
+		new(&storage) T(std::move(value));
+	}
+	policy_partial(policy_partial&& other)
+		: full(other.full)
+	{
+		if (full)
+			new(&storage) T(std::move(other.get()));
+	}
+	policy_partial& operator=(policy_partial&& other)
+	{
+		if (this != &other) {
+			if (full)
+				get().~T();
+			full = other.full;
+			if (full)
+				new(&storage) T(std::move(other.get()));
+		}
+		return *this;
+	}
+	~policy_partial()
+	{
+		if (full)
+			get().~T();
+	}
+
+	bool empty() const
+	{
+		return !full;
+	}
+	T& get()
+	{
+		return *reinterpret_cast<T*>(&storage);
+	}
+};
+
+// Identity function which creates an empty partial result
+template<typename T>
+struct policy_identity {
+	typedef policy_partial<T> result_type;
+	result_type operator()() const
+	{
+		return result_type();
+	}
+};
+
+// Reduction function operating on partial results, which is given either a
+// mapped value or the partial result of another part of the range
+template<typename T, typename ReduceFunc>
+struct policy_reduce_func {
+	ReduceFunc reduce;
+
+	template<typename U>
+	policy_partial<T> operator()(policy_partial<T> x, U&& y)
+	{
+		if (x.empty())
+			return policy_partial<T>(T(std::forward<U>(y)));
+		return policy_partial<T>(reduce(std::move(x.get()), std::forward<U>(y)));
+	}
+	policy_partial<T> operator()(policy_partial<T> x, policy_partial<T> y)
+	{
+		if (y.empty())
+			return x;
+		return (*this)(std::move(x), std::move(y.get()));
+	}
+};
+
+// Reduce the mapped values of a range and combine the result with an initial
+// value. The function objects are copied for each leaf by leaf_copy, since the
+// standard algorithms allow them to have a non-const call operator.
+template<typename Sched, typename Range, typename T, typename MapFunc, typename ReduceFunc>
+T policy_reduce(Sched& sched, Range&& range, T init, const MapFunc& map, const ReduceFunc& reduce)
+{
+	policy_partial<T> out = detail::internal_parallel_map_reduce(sched, async::auto_partitioner(std::forward<Range>(range)), policy_identity<T>(), leaf_copy<MapFunc>{map}, leaf_copy<policy_reduce_func<T, ReduceFunc>>{{reduce}});
+	if (out.empty())
+		return init;
+	ReduceFunc r(reduce);
+	return r(std::move(init), std::move(out.get()));
+}
+
+} // namespace detail
+
+// Parallel versions of the standard algorithms taking an execution policy,
+// with the same signatures as in <algorithm> and <numeric>. These require
+// random access iterators.
+
+template<typename Policy, typename Iter, typename Func>
+typename detail::enable_if_policy<Policy, void>::type for_each(Policy&& policy, Iter first, Iter last, Func func)
+{
+	detail::internal_parallel_for(detail::policy_scheduler(policy), async::auto_partitioner(async::make_range(first, last)), detail::leaf_copy<Func>{func});
+}
+
+template<typename Policy, typename Iter, typename OutIter, typename UnaryOp>
+typename detail::enable_if_policy<Policy, OutIter>::type transform(Policy&& policy, Iter first, Iter last, OutIter out, UnaryOp op)
+{
+	typedef typename std::iterator_traits<Iter>::difference_type difference_type;
+	difference_type length = last - first;
+	auto func = [first, out, op](difference_type i) mutable {
+		out[i] = op(first[i]);
+	};
+	detail::internal_parallel_for(detail::policy_scheduler(policy), async::auto_partitioner(async::irange(difference_type(0), length)), detail::leaf_copy<decltype(func)>{func});
+	return out + length;
+}
+template<typename Policy, typename Iter1, typename Iter2, typename OutIter, typename BinaryOp>
+typename detail::enable_if_policy<Policy, OutIter>::type transform(Policy&& policy, Iter1 first1, Iter1 last1, Iter2 first2, OutIter out, BinaryOp op)
+{
+	typedef typename std::iterator_traits<Iter1>::difference_type difference_type;
+	difference_type length = last1 - first1;
+	auto func = [first1, first2, out, op](difference_type i) mutable {
+		out[i] = op(first1[i], first2[i]);
+	};
+	detail::internal_parallel_for(detail::policy_scheduler(policy), async::auto_partitioner(async::irange(difference_type(0), length)), detail::leaf_copy<decltype(func)>{func});
+	return out + length;
+}
+
+template<typename Policy, typename Iter, typename T, typename BinaryOp>
+typename detail::enable_if_policy<Policy, T>::type reduce(Policy&& policy, Iter first, Iter last, T init, BinaryOp op)
+{
+	return detail::policy_reduce(detail::policy_scheduler(policy), async::make_range(first, last), std::move(init), detail::default_map(), op);
+}
+template<typename Policy, typename Iter, typename T>
+typename detail::enable_if_policy<Policy, T>::type reduce(Policy&& policy, Iter first, Iter last, T init)
+{
+	return async::reduce(std::forward<Policy>(policy), first, last, std::move(init), std::plus<T>());
+}
+template<typename Policy, typename Iter>
+typename detail::enable_if_policy<Policy, typename std::iterator_traits<Iter>::value_type>::type reduce(Policy&& policy, Iter first, Iter last)
+{
+	typedef typename std::iterator_traits<Iter>::value_type value_type;
+	return async::reduce(std::forward<Policy>(policy), first, last, value_type(), std::plus<value_type>());
+}
+
+template<typename Policy, typename Iter1, typename Iter2, typename T, typename BinaryReduceOp, typename BinaryTransformOp>
+typename detail::enable_if_policy<Policy, T>::type transform_reduce(Policy&& policy, Iter1 first1, Iter1 last1, Iter2 first2, T init, BinaryReduceOp reduce, BinaryTransformOp transform)
+{
+	typedef typename std::iterator_traits<Iter1>::difference_type difference_type;
+	return detail::policy_reduce(detail::policy_scheduler(policy), async::irange(difference_type(0), last1 - first1), std::move(init), [first1, first2, transform](difference_type i) mutable {
+		return transform(first1[i], first2[i]);
+	}, reduce);
+}
+template<typename Policy, typename Iter1, typename Iter2, typename T>
+typename detail::enable_if_policy<Policy, T>::type transform_reduce(Policy&& policy, Iter1 first1, Iter1 last1, Iter2 first2, T init)
+{
+	return async::transform_reduce(std::forward<Policy>(policy), first1, last1, first2, std::move(init), std::plus<T>(), std::multiplies<T>());
+}
+template<typename Policy, typename Iter, typename T, typename BinaryReduceOp, typename UnaryTransformOp>
+typename detail::enable_if_policy<Policy, T>::type transform_reduce(Policy&& policy, Iter first, Iter last, T init, BinaryReduceOp reduce, UnaryTransformOp transform)
+{
+	return detail::policy_reduce(detail::policy_scheduler(policy), async::make_range(first, last), std::move(init), transform, reduce);
+}
+
+template<typename Policy, typename Iter, typename Compare>
+typename detail::enable_if_policy<Policy, void>::type sort(Policy&& policy, Iter first, Iter last, Compare comp)
+{
+	async::parallel_sort(detail::policy_scheduler(policy), first, last, comp);
+}
+template<typename Policy, typename Iter>
+typename detail::enable_if_policy<Policy, void>::type sort(Policy&& policy, Iter first, Iter last)
+{
+	async::parallel_sort(detail::policy_scheduler(policy), first, last);
+}
+
+template<typename Policy, typename Iter, typename OutIter, typename BinaryOp, typename T>
+typename detail::enable_if_policy<Policy, OutIter>::type inclusive_scan(Policy&& policy, Iter first, Iter last, OutIter out, BinaryOp op, T init)
+{
+	return async::parallel_inclusive_scan(detail::policy_scheduler(policy), async::make_range(first, last), out, op, std::move(init));
+}
+template<typename Policy, typename Iter, typename OutIter, typename BinaryOp>
+typename detail::enable_if_policy<Policy, OutIter>::type inclusive_scan(Policy&& policy, Iter first, Iter last, OutIter out, BinaryOp op)
+{
+	return async::parallel_inclusive_scan(detail::policy_scheduler(policy), async::make_range(first, last), out, op);
+}
+template<typename Policy, typename Iter, typename OutIter>
+typename detail::enable_if_policy<Policy, OutIter>::type inclusive_scan(Policy&& policy, Iter first, Iter last, OutIter out)
+{
+	return async::parallel_inclusive_scan(detail::policy_scheduler(policy), async::make_range(first, last), out, std::plus<typename std::iterator_traits<Iter>::value_type>());
+}
+
+namespace execution {
+
+// Make the algorithms visible to argument-dependent lookup on the policies, so
+// that unqualified calls work the same way as with the standard policies.
+using async::for_each;
+using async::transform;
+using async::reduce;
+using async::transform_reduce;
+using async::sort;
+using async::inclusive_scan;
+
+} // namespace execution
+} // namespace async
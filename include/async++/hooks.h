@@ -0,0 +1,86 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+// Instrumentation hooks allow a profiler to observe the runtime without any
+// cost when they are not used. To install hooks, define LIBASYNC_HOOKS_HEADER
+// to the name of a header (the ASYNCXX_HOOKS_HEADER CMake option does this for
+// both the library and its users). That header must define a class with the
+// same static member functions as async::no_hooks and then define
+// LIBASYNC_HOOKS to the name of that class. It is included from inside
+// <async++.h>, so it should only depend on standard headers. Symbols declared
+// in it are hidden, so the library and the program each get their own copy of
+// any static data: hooks which share state should forward to a function that
+// is defined outside the header.
+//
+// Tasks are identified by the address of their internal task object, which
+// may be reused after the task is destroyed. Threads are identified by their
+// index in the thread pool.
+#ifdef LIBASYNC_HOOKS_HEADER
+# include LIBASYNC_HOOKS_HEADER
+#endif
+
+namespace async {
+
+// Default hooks which do nothing
+struct no_hooks {
+	// A task object was created by spawn(), local_spawn() or then()
+	static void task_created(const void*) {}
+
+	// A task was handed to its scheduler
+	static void task_scheduled(const void*) {}
+
+	// A task function started and finished running. The finish hook is also
+	// called if the function threw an exception.
+	static void task_started(const void*) {}
+	static void task_finished(const void*) {}
+
+	// A task was canceled, either by an exception or because it was never run
+	static void task_canceled(const void*) {}
+
+	// A thread pool worker took a task from another thread's queue or mailbox
+	static void task_stolen(const void*, std::size_t /*thief*/, std::size_t /*victim*/) {}
+
+	// A thread pool worker went to sleep because it found no tasks, and woke up
+	static void worker_park(std::size_t) {}
+	static void worker_unpark(std::size_t) {}
+
+	// A continuation was attached to a task which had not finished yet
+	static void continuation_added(const void* /*parent*/, const void* /*continuation*/) {}
+};
+
+namespace detail {
+
+// Hooks used by the runtime. Custom hooks take priority over USDT probes, but
+// can forward to usdt_hooks to keep the probes.
+#ifdef LIBASYNC_HOOKS
+typedef LIBASYNC_HOOKS hooks;
+#elif defined(LIBASYNC_HAVE_USDT_PROBES)
+typedef usdt_hooks hooks;
+#else
+typedef no_hooks hooks;
+#endif
+
+} // namespace detail
+} // namespace async
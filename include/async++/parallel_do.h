@@ -0,0 +1,216 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+template<typename Sched, typename Item, typename Body>
+struct parallel_do_task;
+
+} // namespace detail
+
+// Handle passed to the body of parallel_do, which can be used to add new items
+// to the work list while processing an item.
+template<typename Item>
+class parallel_do_feeder {
+	template<typename Sched, typename T, typename Body>
+	friend struct detail::parallel_do_task;
+
+	std::deque<Item>& items;
+
+	explicit parallel_do_feeder(std::deque<Item>& items)
+		: items(items) {}
+
+public:
+	parallel_do_feeder(const parallel_do_feeder&) = delete;
+	parallel_do_feeder& operator=(const parallel_do_feeder&) = delete;
+
+	void add(const Item& item)
+	{
+		items.push_back(item);
+	}
+	void add(Item&& item)
+	{
+		items.push_back(std::move(item));
+	}
+};
+
+namespace detail {
+
+// Once a task has more than this many pending fed items, half of them are
+// handed off to a new task which other threads can steal.
+const std::size_t parallel_do_batch_size = 16;
+
+// Shared state of a parallel_do call. The last task to finish sets the event,
+// with the first exception thrown by the body if there was one.
+template<typename Sched, typename Item, typename Body>
+struct parallel_do_state {
+	Sched& sched;
+	const Body& body;
+	std::vector<Item> initial;
+	std::atomic<std::size_t> pending;
+	std::atomic<bool> failed;
+	std::mutex lock;
+	std::exception_ptr except;
+	event_task<void> done;
+
+	parallel_do_state(Sched& sched, const Body& body, std::vector<Item> initial)
+		: sched(sched), body(body), initial(std::move(initial)), pending(1), failed(false) {}
+};
+
+// Check whether the body accepts a feeder as its second parameter
+template<typename Body, typename Item, typename = decltype(std::declval<const Body&>()(std::declval<Item&>(), std::declval<parallel_do_feeder<Item>&>()))>
+two& is_feeder_body_helper(int);
+template<typename Body, typename Item>
+one& is_feeder_body_helper(...);
+template<typename Body, typename Item>
+struct is_feeder_body: public std::integral_constant<bool, sizeof(is_feeder_body_helper<Body, Item>(0)) - 1> {};
+
+template<typename Body, typename Item>
+void call_parallel_do_body(const Body& body, Item& item, parallel_do_feeder<Item>& feeder, std::true_type)
+{
+	body(item, feeder);
+}
+template<typename Body, typename Item>
+void call_parallel_do_body(const Body& body, Item& item, parallel_do_feeder<Item>&, std::false_type)
+{
+	body(item);
+}
+
+// Task which processes part of the initial items and the items fed by them.
+// The initial items are known up front, so they are split in half down to
+// single items, the same way as parallel_invoke, and every one of them can be
+// picked up by another thread right away. Fed items are processed by the task
+// which fed them, most recently added first, and the oldest half of them is
+// split off into a new task whenever there are too many.
+//
+// Fed items are kept in a private deque instead of being pushed one at a time
+// onto the worker's work_steal_queue, which only holds tasks and is private to
+// the thread pool. Spawning a task for a batch of items puts that batch on the
+// same queue, where idle threads steal it, and works with any scheduler.
+template<typename Sched, typename Item, typename Body>
+struct parallel_do_task {
+	std::shared_ptr<parallel_do_state<Sched, Item, Body>> state;
+	std::size_t first, last;
+	std::deque<Item> items;
+
+	parallel_do_task(std::shared_ptr<parallel_do_state<Sched, Item, Body>> state, std::size_t first, std::size_t last, std::deque<Item> items)
+		: state(std::move(state)), first(first), last(last), items(std::move(items)) {}
+
+	void spawn_task(std::size_t sub_first, std::size_t sub_last, std::deque<Item> sub_items)
+	{
+		state->pending.fetch_add(1, std::memory_order_relaxed);
+		LIBASYNC_TRY {
+			async::spawn(state->sched, parallel_do_task(state, sub_first, sub_last, std::move(sub_items)));
+		} LIBASYNC_CATCH(...) {
+			state->pending.fetch_sub(1, std::memory_order_relaxed);
+			LIBASYNC_RETHROW();
+		}
+	}
+
+	void operator()()
+	{
+		LIBASYNC_TRY {
+			while (last - first > 1 && !state->failed.load(std::memory_order_relaxed)) {
+				std::size_t middle = first + (last - first) / 2;
+				spawn_task(middle, last, std::deque<Item>());
+				last = middle;
+			}
+			if (first != last)
+				items.push_back(std::move(state->initial[first]));
+
+			parallel_do_feeder<Item> feeder(items);
+			while (!items.empty() && !state->failed.load(std::memory_order_relaxed)) {
+				Item item = std::move(items.back());
+				items.pop_back();
+				detail::call_parallel_do_body(state->body, item, feeder, is_feeder_body<Body, Item>());
+
+				if (items.size() > parallel_do_batch_size) {
+					auto middle = items.begin() + items.size() / 2;
+					std::deque<Item> half(std::make_move_iterator(items.begin()), std::make_move_iterator(middle));
+					items.erase(items.begin(), middle);
+					spawn_task(0, 0, std::move(half));
+				}
+			}
+		} LIBASYNC_CATCH(...) {
+			std::lock_guard<std::mutex> locked(state->lock);
+			if (!state->except)
+				state->except = std::current_exception();
+			state->failed.store(true, std::memory_order_relaxed);
+		}
+
+		// The last task to finish signals completion
+		if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			if (state->except)
+				state->done.set_exception(state->except);
+			else
+				state->done.set();
+		}
+	}
+};
+
+} // namespace detail
+
+// Process a dynamic work list in parallel. The body is called with each item
+// and, if it accepts one, a parallel_do_feeder which can be used to add more
+// items. This returns once all items have been processed. If the body throws,
+// the remaining items are discarded and the first exception is rethrown.
+template<typename Sched, typename Range, typename Body>
+void parallel_do(Sched& sched, Range&& range, const Body& body)
+{
+	typedef typename std::decay<decltype(*std::begin(range))>::type item_type;
+	std::vector<item_type> items(std::begin(range), std::end(range));
+	if (items.empty())
+		return;
+
+	// The calling thread splits up the initial items and then processes the
+	// first one of them itself
+	std::size_t count = items.size();
+	auto state = std::make_shared<detail::parallel_do_state<Sched, item_type, Body>>(sched, body, std::move(items));
+	task<void> done = state->done.get_task();
+	detail::parallel_do_task<Sched, item_type, Body>(state, 0, count, std::deque<item_type>())();
+	done.get();
+}
+
+// Overload with default scheduler
+template<typename Range, typename Body>
+void parallel_do(Range&& range, const Body& body)
+{
+	async::parallel_do(::async::default_scheduler(), std::forward<Range>(range), body);
+}
+
+// Overloads with std::initializer_list
+template<typename Sched, typename T, typename Body>
+void parallel_do(Sched& sched, std::initializer_list<T> range, const Body& body)
+{
+	async::parallel_do(sched, async::make_range(range.begin(), range.end()), body);
+}
+template<typename T, typename Body>
+void parallel_do(std::initializer_list<T> range, const Body& body)
+{
+	async::parallel_do(async::make_range(range.begin(), range.end()), body);
+}
+
+} // namespace async
@@ -0,0 +1,213 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Iterator type of the partitioner created for a range
+template<typename Range>
+struct partitioner_iterator {
+	typedef typename std::decay<decltype(async::to_partitioner(std::declval<Range>()))>::type partitioner_type;
+	typedef decltype(std::declval<partitioner_type&>().begin()) type;
+};
+
+// Position value indicating that no match has been found
+const std::size_t find_not_found = static_cast<std::size_t>(-1);
+
+// Shared state of a parallel search. The position of the best match found so
+// far doubles as the stop flag: any subrange which can't contain a better match
+// is skipped, and running leaves check it before each element.
+struct find_state {
+	std::atomic<std::size_t> result;
+	bool first_match;
+
+	explicit find_state(bool first_match)
+		: result(find_not_found), first_match(first_match) {}
+
+	// Check whether the search should stop before the given position. When
+	// looking for the first match, only positions after an existing match can
+	// be skipped. Otherwise the search stops as soon as anything is found.
+	bool should_stop(std::size_t pos) const
+	{
+		std::size_t current = result.load(std::memory_order_relaxed);
+		return first_match ? pos >= current : current != find_not_found;
+	}
+
+	// Record a match, keeping the lowest position
+	void found(std::size_t pos)
+	{
+		std::size_t current = result.load(std::memory_order_relaxed);
+		while (pos < current && !result.compare_exchange_weak(current, pos, std::memory_order_relaxed)) {}
+	}
+};
+
+// Recursively split the partitioner and search each part, skipping any part
+// which has been made unnecessary by a match in another one. The position and
+// length of the partitioner are passed down so that they don't have to be
+// recomputed from the start of the range at every level.
+template<typename Sched, typename Partitioner, typename Pred>
+void internal_parallel_find(Sched& sched, Partitioner partitioner, std::size_t pos, std::size_t length, const Pred& pred, find_state& state)
+{
+	if (state.should_stop(pos))
+		return;
+
+	// Split the partition, run inline if no more splits are possible
+	auto subpart = partitioner.split();
+	if (subpart.begin() == subpart.end()) {
+		std::size_t start = pos;
+		do {
+			for (auto&& i: partitioner) {
+				if (state.should_stop(pos))
+					return;
+				if (pred(std::forward<decltype(i)>(i))) {
+					state.found(pos);
+					return;
+				}
+				pos++;
+			}
+		} while (detail::next_chunk(partitioner));
+
+		// Split whatever a chunked partitioner has left over
+		if (detail::has_remaining_chunks(partitioner))
+			detail::internal_parallel_find(sched, std::move(partitioner), pos, length - (pos - start), pred, state);
+		return;
+	}
+
+	// Search the second half in a child task, its starting position is
+	// checked again once it starts running.
+	std::size_t sublength = detail::partitioner_size(subpart);
+	length -= sublength;
+	auto&& child_sched = detail::child_scheduler(sched, subpart);
+	auto&& t = async::local_spawn(child_sched, [&sched, &subpart, pos, length, sublength, &pred, &state] {
+		detail::internal_parallel_find(sched, std::move(subpart), pos + length, sublength, pred, state);
+	});
+	detail::internal_parallel_find(sched, std::move(partitioner), pos, length, pred, state);
+	t.get();
+}
+
+// Search a partitioner and return an iterator to the match, or the end of the
+// partitioner if no match was found. When looking for the first match, the
+// first half of each split is searched inline while the second half is left to
+// other threads, and any part after a match is skipped.
+template<typename Sched, typename Partitioner, typename Pred>
+decltype(std::declval<Partitioner&>().begin()) parallel_find_partitioner(Sched& sched, Partitioner partitioner, const Pred& pred, bool first_match)
+{
+	auto begin = partitioner.begin();
+	auto end = partitioner.end();
+	std::size_t length = detail::partitioner_size(partitioner);
+	find_state state(first_match);
+	detail::internal_parallel_find(sched, std::move(partitioner), 0, length, pred, state);
+
+	std::size_t result = state.result.load(std::memory_order_relaxed);
+	if (result == find_not_found)
+		return end;
+	std::advance(begin, result);
+	return begin;
+}
+
+} // namespace detail
+
+// Find an element of a range which satisfies a predicate, or return the end of
+// the range if there is none. This stops as soon as any match is found, so the
+// match returned is not necessarily the first one in the range.
+template<typename Sched, typename Range, typename Pred>
+typename detail::partitioner_iterator<Range>::type parallel_find_if(Sched& sched, Range&& range, const Pred& pred)
+{
+	return detail::parallel_find_partitioner(sched, async::to_partitioner(std::forward<Range>(range)), pred, false);
+}
+
+// Find the first element of a range which satisfies a predicate, or return the
+// end of the range if there is none. Parts of the range after a match that has
+// already been found are skipped.
+template<typename Sched, typename Range, typename Pred>
+typename detail::partitioner_iterator<Range>::type parallel_find_first(Sched& sched, Range&& range, const Pred& pred)
+{
+	return detail::parallel_find_partitioner(sched, async::to_partitioner(std::forward<Range>(range)), pred, true);
+}
+
+// Check whether any, all or none of the elements of a range satisfy a predicate
+template<typename Sched, typename Range, typename Pred>
+bool parallel_any_of(Sched& sched, Range&& range, const Pred& pred)
+{
+	auto partitioner = async::to_partitioner(std::forward<Range>(range));
+	auto end = partitioner.end();
+	return detail::parallel_find_partitioner(sched, std::move(partitioner), pred, false) != end;
+}
+template<typename Sched, typename Range, typename Pred>
+bool parallel_none_of(Sched& sched, Range&& range, const Pred& pred)
+{
+	return !async::parallel_any_of(sched, std::forward<Range>(range), pred);
+}
+template<typename Sched, typename Range, typename Pred>
+bool parallel_all_of(Sched& sched, Range&& range, const Pred& pred)
+{
+	return !async::parallel_any_of(sched, std::forward<Range>(range), detail::not_pred<Pred>{pred});
+}
+
+// Overloads with default scheduler
+template<typename Range, typename Pred>
+typename detail::partitioner_iterator<Range>::type parallel_find_if(Range&& range, const Pred& pred)
+{
+	return async::parallel_find_if(::async::default_scheduler(), std::forward<Range>(range), pred);
+}
+template<typename Range, typename Pred>
+typename detail::partitioner_iterator<Range>::type parallel_find_first(Range&& range, const Pred& pred)
+{
+	return async::parallel_find_first(::async::default_scheduler(), std::forward<Range>(range), pred);
+}
+template<typename Range, typename Pred>
+bool parallel_any_of(Range&& range, const Pred& pred)
+{
+	return async::parallel_any_of(::async::default_scheduler(), std::forward<Range>(range), pred);
+}
+template<typename Range, typename Pred>
+bool parallel_none_of(Range&& range, const Pred& pred)
+{
+	return async::parallel_none_of(::async::default_scheduler(), std::forward<Range>(range), pred);
+}
+template<typename Range, typename Pred>
+bool parallel_all_of(Range&& range, const Pred& pred)
+{
+	return async::parallel_all_of(::async::default_scheduler(), std::forward<Range>(range), pred);
+}
+
+// Overloads with std::initializer_list
+template<typename T, typename Pred>
+bool parallel_any_of(std::initializer_list<T> range, const Pred& pred)
+{
+	return async::parallel_any_of(async::make_range(range.begin(), range.end()), pred);
+}
+template<typename T, typename Pred>
+bool parallel_none_of(std::initializer_list<T> range, const Pred& pred)
+{
+	return async::parallel_none_of(async::make_range(range.begin(), range.end()), pred);
+}
+template<typename T, typename Pred>
+bool parallel_all_of(std::initializer_list<T> range, const Pred& pred)
+{
+	return async::parallel_all_of(async::make_range(range.begin(), range.end()), pred);
+}
+
+} // namespace async
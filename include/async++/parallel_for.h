@@ -25,6 +25,35 @@
 namespace async {
 namespace detail {
 
+// Wrapper around a function object which gives each leaf of a parallel
+// algorithm its own copy of it. This allows function objects with a non-const
+// call operator, which must not be shared between threads.
+template<typename Func>
+struct leaf_copy {
+	Func func;
+
+	// Calls made outside a leaf use a temporary copy
+	template<typename... Args>
+	auto operator()(Args&&... args) const -> decltype(std::declval<Func&>()(std::forward<Args>(args)...))
+	{
+		Func f(func);
+		return f(std::forward<Args>(args)...);
+	}
+};
+
+// Get the function object to use in a leaf: either the function itself or a
+// fresh copy of a wrapped one.
+template<typename Func>
+const Func& leaf_function(const Func& func)
+{
+	return func;
+}
+template<typename Func>
+Func leaf_function(const leaf_copy<Func>& func)
+{
+	return func.func;
+}
+
 // Internal implementation of parallel_for that only accepts a partitioner
 // argument.
 template<typename Sched, typename Partitioner, typename Func>
@@ -35,8 +64,15 @@ void internal_parallel_for(Sched& sched, Partitioner partitioner, const Func& fu
 	// 递归结束条件，不能再分的时候，到达最小单元
 	// 在当前线程中直接执行task
 	if (subpart.begin() == subpart.end()) {
-		for (auto&& i: partitioner)
-			func(std::forward<decltype(i)>(i));  // apply函数在range的一项上
+		auto&& f = detail::leaf_function(func);
+		do {
+			for (auto&& i: partitioner)
+				f(std::forward<decltype(i)>(i));  // apply函数在range的一项上
+		} while (detail::next_chunk(partitioner));
+
+		// Split whatever a chunked partitioner has left over
+		if (detail::has_remaining_chunks(partitioner))
+			detail::internal_parallel_for(sched, std::move(partitioner), func);
 		return;
 	}
 	/*
@@ -54,7 +90,8 @@ void internal_parallel_for(Sched& sched, Partitioner partitioner, const Func& fu
 	因此thread pool需要支持：从线程提交的task优先进入本地线程的本地task queue中
 	*/
 	// Run the function over each half in parallel
-	auto&& t = async::local_spawn(sched, [&sched, &subpart, &func] {
+	auto&& child_sched = detail::child_scheduler(sched, subpart);
+	auto&& t = async::local_spawn(child_sched, [&sched, &subpart, &func] {
 		detail::internal_parallel_for(sched, std::move(subpart), func);
 	});
 	detail::internal_parallel_for(sched, std::move(partitioner), func);
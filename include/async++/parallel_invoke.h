@@ -57,6 +57,55 @@ struct parallel_invoke_internal<Index, 0> {
 	static void run(Sched&, const Tuple&) {}
 };
 
+// Check whether a type is a range of functions taking no arguments, as opposed
+// to a function itself.
+template<typename T, typename = decltype(std::declval<decltype(*std::begin(std::declval<T&>()))>()())>
+two& is_function_range_helper(int);
+template<typename T>
+one& is_function_range_helper(...);
+template<typename T>
+struct is_function_range: public std::integral_constant<bool, sizeof(is_function_range_helper<T>(0)) - 1 && !is_callable<T()>::value> {};
+
+// Pick the point at which to split the functions [start, end). Without cost
+// hints this is the middle, otherwise it is the point which best balances the
+// total cost of both halves, given the prefix sums of the costs.
+template<typename Cost>
+std::size_t parallel_invoke_split(std::size_t start, std::size_t end, const Cost* prefix)
+{
+	if (!prefix)
+		return start + (end - start) / 2;
+
+	Cost target = prefix[start] + (prefix[end] - prefix[start]) / 2;
+	std::size_t middle = std::lower_bound(prefix + start + 1, prefix + end, target) - prefix;
+	if (middle == end || (middle - 1 > start && target - prefix[middle - 1] < prefix[middle] - target))
+		middle--;
+	return middle;
+}
+
+// Recursively split a range of functions, the same way as the fixed-size
+// version above. The iterator points to the function at index start, and each
+// half gets its own iterator so that none of them is advanced from the start of
+// the range.
+template<typename Sched, typename Iter, typename Cost>
+void parallel_invoke_range(Sched& sched, Iter begin, std::size_t start, std::size_t end, const Cost* prefix)
+{
+	if (end - start == 0)
+		return;
+	if (end - start == 1) {
+		(*begin)();
+		return;
+	}
+
+	std::size_t middle = detail::parallel_invoke_split(start, end, prefix);
+	Iter mid = begin;
+	std::advance(mid, middle - start);
+	auto&& t = async::local_spawn(sched, [&sched, &mid, middle, end, prefix] {
+		detail::parallel_invoke_range(sched, std::move(mid), middle, end, prefix);
+	});
+	detail::parallel_invoke_range(sched, std::move(begin), start, middle, prefix);
+	t.get();
+}
+
 } // namespace detail
 
 // Run several functions in parallel, optionally using the specified scheduler.
@@ -72,4 +121,42 @@ void parallel_invoke(Args&&... args)
 	async::parallel_invoke(::async::default_scheduler(), std::forward<Args>(args)...);
 }
 
+// Run all functions in a range in parallel, for when the number of functions
+// is only known at runtime. An optional range of costs, one for each function,
+// can be given to balance the work done on each side of a split.
+template<typename Sched, typename Range>
+typename std::enable_if<detail::is_scheduler<Sched>::value && detail::is_function_range<Range>::value>::type
+parallel_invoke(Sched& sched, Range&& range)
+{
+	std::size_t count = std::distance(std::begin(range), std::end(range));
+	detail::parallel_invoke_range<Sched, decltype(std::begin(range)), std::size_t>(sched, std::begin(range), 0, count, nullptr);
+}
+template<typename Sched, typename Range, typename Costs>
+typename std::enable_if<detail::is_scheduler<Sched>::value && detail::is_function_range<Range>::value>::type
+parallel_invoke(Sched& sched, Range&& range, Costs&& costs)
+{
+	typedef typename std::decay<decltype(*std::begin(costs))>::type cost_type;
+	std::size_t count = std::distance(std::begin(range), std::end(range));
+
+	// The prefix sums give the number of costs, so they are only walked once
+	std::vector<cost_type> prefix(1, cost_type());
+	prefix.reserve(count + 1);
+	for (auto&& i: costs)
+		prefix.push_back(prefix.back() + i);
+	LIBASYNC_ASSERT(prefix.size() - 1 == count, std::invalid_argument, "Number of costs doesn't match number of functions");
+	detail::parallel_invoke_range(sched, std::begin(range), 0, count, prefix.data());
+}
+template<typename Range>
+typename std::enable_if<detail::is_function_range<Range>::value>::type
+parallel_invoke(Range&& range)
+{
+	async::parallel_invoke(::async::default_scheduler(), std::forward<Range>(range));
+}
+template<typename Range, typename Costs>
+typename std::enable_if<detail::is_function_range<Range>::value>::type
+parallel_invoke(Range&& range, Costs&& costs)
+{
+	async::parallel_invoke(::async::default_scheduler(), std::forward<Range>(range), std::forward<Costs>(costs));
+}
+
 } // namespace async
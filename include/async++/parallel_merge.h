@@ -0,0 +1,117 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Sequences smaller than this are merged serially
+const std::size_t merge_cutoff = 2048;
+
+// Find the co-rank of position k in the merge of two sorted sequences, which
+// is the number of elements of the first sequence among the first k elements
+// of the output. Ties are resolved in favor of the first sequence, which makes
+// the merge stable.
+template<typename Iter1, typename Iter2, typename Compare>
+std::size_t merge_co_rank(std::size_t k, Iter1 begin1, std::size_t length1, Iter2 begin2, std::size_t length2, const Compare& comp)
+{
+	// Taking i elements from the first sequence is too many if the last of
+	// them should come after the next element of the second sequence. This
+	// predicate is monotonic in i, so we can binary search for the largest i
+	// for which it is false.
+	std::size_t low = k > length2 ? k - length2 : 0;
+	std::size_t high = k < length1 ? k : length1;
+	while (low < high) {
+		std::size_t i = low + (high - low + 1) / 2;
+		if (comp(begin2[k - i], begin1[i - 1]))
+			high = i - 1;
+		else
+			low = i;
+	}
+	return low;
+}
+
+// Internal implementation of parallel_merge. The output is divided into equal
+// sized blocks and the co-rank of each block boundary is used to find the
+// parts of the inputs which are merged serially into that block.
+template<typename Sched, typename Iter1, typename Iter2, typename OutIter, typename Compare>
+OutIter internal_parallel_merge(Sched& sched, Iter1 begin1, Iter1 end1, Iter2 begin2, Iter2 end2, OutIter out, const Compare& comp)
+{
+	std::size_t length1 = end1 - begin1;
+	std::size_t length2 = end2 - begin2;
+	std::size_t length = length1 + length2;
+	if (length <= merge_cutoff)
+		return std::merge(begin1, end1, begin2, end2, out, comp);
+
+	// All co-ranks are found before any block is merged, because the inputs
+	// may be move iterators and a merged block leaves moved-from elements
+	// behind for the binary searches of its neighbours.
+	std::size_t block = detail::scan_block_size(length);
+	std::size_t num_blocks = (length + block - 1) / block;
+	std::vector<std::size_t> ranks(num_blocks + 1);
+	async::parallel_for(sched, async::irange(std::size_t(0), num_blocks + 1), [=, &ranks, &comp](std::size_t i) {
+		std::size_t k = i * block < length ? i * block : length;
+		ranks[i] = detail::merge_co_rank(k, begin1, length1, begin2, length2, comp);
+	});
+	async::parallel_for(sched, async::irange(std::size_t(0), num_blocks), [=, &ranks, &comp](std::size_t i) {
+		std::size_t k_begin = i * block;
+		std::size_t k_end = k_begin + block < length ? k_begin + block : length;
+		std::size_t i_begin = ranks[i];
+		std::size_t i_end = ranks[i + 1];
+		std::merge(begin1 + i_begin, begin1 + i_end, begin2 + (k_begin - i_begin), begin2 + (k_end - i_end), out + k_begin, comp);
+	});
+	return out + length;
+}
+
+} // namespace detail
+
+// Merge two sorted ranges into an output sequence, returning the end of the
+// output. The merge is stable: equal elements from the first range come before
+// those from the second. All iterators must be random-access.
+template<typename Sched, typename Range1, typename Range2, typename OutIter, typename Compare>
+OutIter parallel_merge(Sched& sched, Range1&& range1, Range2&& range2, OutIter out, const Compare& comp)
+{
+	return detail::internal_parallel_merge(sched, std::begin(range1), std::end(range1), std::begin(range2), std::end(range2), out, comp);
+}
+template<typename Sched, typename Range1, typename Range2, typename OutIter>
+typename std::enable_if<detail::is_scheduler<Sched>::value, OutIter>::type
+parallel_merge(Sched& sched, Range1&& range1, Range2&& range2, OutIter out)
+{
+	return async::parallel_merge(sched, range1, range2, out, std::less<typename std::iterator_traits<decltype(std::begin(range1))>::value_type>());
+}
+
+// Overloads with default scheduler
+template<typename Range1, typename Range2, typename OutIter, typename Compare>
+typename std::enable_if<!detail::is_scheduler<typename std::decay<Range1>::type>::value, OutIter>::type
+parallel_merge(Range1&& range1, Range2&& range2, OutIter out, const Compare& comp)
+{
+	return async::parallel_merge(::async::default_scheduler(), range1, range2, out, comp);
+}
+template<typename Range1, typename Range2, typename OutIter>
+OutIter parallel_merge(Range1&& range1, Range2&& range2, OutIter out)
+{
+	return async::parallel_merge(::async::default_scheduler(), range1, range2, out);
+}
+
+} // namespace async
@@ -0,0 +1,252 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Count the elements of each block which satisfy a predicate and turn the
+// counts into the offset of each block in the output. The result has one more
+// element than the number of blocks, the last one being the total count.
+template<typename Sched, typename Iter, typename Pred>
+std::vector<std::size_t> block_offsets(Sched& sched, const std::vector<Iter>& blocks, const Pred& pred)
+{
+	std::size_t num_blocks = blocks.size() - 1;
+	std::vector<std::size_t> offsets(num_blocks + 1, 0);
+	async::parallel_for(sched, async::irange(std::size_t(0), num_blocks), [&blocks, &offsets, &pred](std::size_t i) {
+		offsets[i + 1] = std::count_if(blocks[i], blocks[i + 1], pred);
+	});
+	for (std::size_t i = 0; i < num_blocks; i++)
+		offsets[i + 1] += offsets[i];
+	return offsets;
+}
+
+// Negation of a predicate
+template<typename Pred>
+struct not_pred {
+	const Pred& pred;
+
+	template<typename T>
+	bool operator()(T&& x) const
+	{
+		return !pred(std::forward<T>(x));
+	}
+};
+
+// Internal implementation of parallel_copy_if. This is a stream compaction:
+// the matching elements of each block are counted, the counts are turned into
+// output offsets with a prefix sum, and then each block is copied to its
+// offset in parallel.
+template<typename Sched, typename Iter, typename OutIter, typename Pred>
+OutIter internal_parallel_copy_if(Sched& sched, Iter begin, Iter end, OutIter out, const Pred& pred)
+{
+	std::size_t length = std::distance(begin, end);
+	std::vector<Iter> blocks = detail::block_boundaries(begin, length, detail::scan_block_size(length));
+	std::vector<std::size_t> offsets = detail::block_offsets(sched, blocks, pred);
+
+	async::parallel_for(sched, async::irange(std::size_t(0), blocks.size() - 1), [&blocks, &offsets, out, &pred](std::size_t i) {
+		OutIter o = out;
+		std::advance(o, offsets[i]);
+		std::copy_if(blocks[i], blocks[i + 1], o, pred);
+	});
+
+	std::advance(out, offsets.back());
+	return out;
+}
+
+// Internal implementation of parallel_stable_partition and parallel_remove_if.
+// The elements are moved into a temporary buffer, and each block of the buffer
+// moves the elements which satisfy the predicate to their position in the
+// first part of the sequence. If keep_rest is set then the other elements are
+// moved to the second part of the sequence, otherwise they are dropped.
+template<typename Sched, typename Iter, typename Pred>
+Iter internal_parallel_stable_partition(Sched& sched, Iter begin, Iter end, const Pred& pred, bool keep_rest)
+{
+	typedef typename std::iterator_traits<Iter>::value_type value_type;
+
+	std::size_t length = std::distance(begin, end);
+	if (length == 0)
+		return begin;
+	move_buffer<Sched, value_type> buffer(sched, begin, length);
+	std::vector<value_type*> blocks = detail::block_boundaries(buffer.get(), length, detail::scan_block_size(length));
+	std::vector<std::size_t> offsets = detail::block_offsets(sched, blocks, pred);
+	std::size_t total = offsets.back();
+
+	async::parallel_for(sched, async::irange(std::size_t(0), blocks.size() - 1), [&blocks, &offsets, begin, total, &pred, keep_rest](std::size_t i) {
+		Iter first = begin + offsets[i];
+		Iter second = begin + (total + (blocks[i] - blocks[0]) - offsets[i]);
+		for (value_type* p = blocks[i]; p != blocks[i + 1]; ++p) {
+			if (pred(*p))
+				*first++ = std::move(*p);
+			else if (keep_rest)
+				*second++ = std::move(*p);
+		}
+	});
+
+	return begin + total;
+}
+
+// A contiguous part of a sequence whose elements need to be swapped
+template<typename Iter>
+struct swap_segment {
+	Iter begin;
+	std::size_t length;
+};
+
+// Add a segment to a list of segments and update the total length
+template<typename Iter>
+void add_swap_segment(std::vector<swap_segment<Iter>>& segments, std::vector<std::size_t>& offsets, Iter begin, Iter end)
+{
+	if (begin < end) {
+		segments.push_back({begin, static_cast<std::size_t>(end - begin)});
+		offsets.push_back(offsets.back() + (end - begin));
+	}
+}
+
+// Internal implementation of parallel_partition. Each block is partitioned in
+// place in parallel. After that, the elements which are on the wrong side of
+// the partition point form two lists of segments of the same total length,
+// which are swapped with each other in parallel.
+template<typename Sched, typename Iter, typename Pred>
+Iter internal_parallel_partition(Sched& sched, Iter begin, Iter end, const Pred& pred)
+{
+	std::size_t length = end - begin;
+	std::vector<Iter> blocks = detail::block_boundaries(begin, length, detail::scan_block_size(length));
+	std::size_t num_blocks = blocks.size() - 1;
+	if (num_blocks <= 1)
+		return std::partition(begin, end, pred);
+
+	// Partition each block
+	std::vector<Iter> mids(num_blocks);
+	async::parallel_for(sched, async::irange(std::size_t(0), num_blocks), [&blocks, &mids, &pred](std::size_t i) {
+		mids[i] = std::partition(blocks[i], blocks[i + 1], pred);
+	});
+	Iter split = begin;
+	for (std::size_t i = 0; i < num_blocks; i++)
+		split += mids[i] - blocks[i];
+
+	// Collect the elements before the partition point which don't satisfy the
+	// predicate and the ones after it which do.
+	std::vector<swap_segment<Iter>> left, right;
+	std::vector<std::size_t> left_offsets(1, 0), right_offsets(1, 0);
+	for (std::size_t i = 0; i < num_blocks; i++) {
+		detail::add_swap_segment(left, left_offsets, mids[i], std::min(blocks[i + 1], split));
+		detail::add_swap_segment(right, right_offsets, std::max(blocks[i], split), mids[i]);
+	}
+
+	// Swap the n-th misplaced element on the left with the n-th on the right
+	std::size_t total = left_offsets.back();
+	std::size_t block = detail::scan_block_size(total);
+	async::parallel_for(sched, async::irange(std::size_t(0), (total + block - 1) / block), [&, block](std::size_t i) {
+		std::size_t pos = i * block;
+		std::size_t count = pos + block < total ? block : total - pos;
+		std::size_t l = std::upper_bound(left_offsets.begin(), left_offsets.end(), pos) - left_offsets.begin() - 1;
+		std::size_t r = std::upper_bound(right_offsets.begin(), right_offsets.end(), pos) - right_offsets.begin() - 1;
+		std::size_t l_pos = pos - left_offsets[l];
+		std::size_t r_pos = pos - right_offsets[r];
+		while (count != 0) {
+			std::size_t step = std::min(count, std::min(left[l].length - l_pos, right[r].length - r_pos));
+			std::swap_ranges(left[l].begin + l_pos, left[l].begin + (l_pos + step), right[r].begin + r_pos);
+			count -= step;
+			l_pos += step;
+			r_pos += step;
+			if (l_pos == left[l].length) {
+				l++;
+				l_pos = 0;
+			}
+			if (r_pos == right[r].length) {
+				r++;
+				r_pos = 0;
+			}
+		}
+	});
+
+	return split;
+}
+
+} // namespace detail
+
+// Copy the elements of a range which satisfy a predicate to an output sequence
+// while preserving their order, returning the end of the output. The output
+// iterator must be a forward iterator and the predicate is called twice on
+// each element.
+template<typename Sched, typename Range, typename OutIter, typename Pred>
+OutIter parallel_copy_if(Sched& sched, Range&& range, OutIter out, const Pred& pred)
+{
+	return detail::internal_parallel_copy_if(sched, std::begin(range), std::end(range), out, pred);
+}
+
+// Remove the elements of a range which satisfy a predicate while preserving
+// the order of the remaining elements, returning the new end of the range.
+// This uses a temporary buffer the size of the range.
+template<typename Sched, typename Range, typename Pred>
+typename std::enable_if<detail::is_scheduler<Sched>::value, decltype(std::begin(std::declval<Range&>()))>::type
+parallel_remove_if(Sched& sched, Range&& range, const Pred& pred)
+{
+	return detail::internal_parallel_stable_partition(sched, std::begin(range), std::end(range), detail::not_pred<Pred>{pred}, false);
+}
+
+// Reorder a range so that the elements which satisfy a predicate come first,
+// returning the partition point. The relative order of elements is not
+// preserved, but no temporary buffer is needed. The range must have
+// random-access iterators.
+template<typename Sched, typename Range, typename Pred>
+typename std::enable_if<detail::is_scheduler<Sched>::value, decltype(std::begin(std::declval<Range&>()))>::type
+parallel_partition(Sched& sched, Range&& range, const Pred& pred)
+{
+	return detail::internal_parallel_partition(sched, std::begin(range), std::end(range), pred);
+}
+
+// Like parallel_partition, but preserves the relative order of elements in
+// both parts. This uses a temporary buffer the size of the range.
+template<typename Sched, typename Range, typename Pred>
+typename std::enable_if<detail::is_scheduler<Sched>::value, decltype(std::begin(std::declval<Range&>()))>::type
+parallel_stable_partition(Sched& sched, Range&& range, const Pred& pred)
+{
+	return detail::internal_parallel_stable_partition(sched, std::begin(range), std::end(range), pred, true);
+}
+
+// Overloads with default scheduler
+template<typename Range, typename OutIter, typename Pred>
+OutIter parallel_copy_if(Range&& range, OutIter out, const Pred& pred)
+{
+	return async::parallel_copy_if(::async::default_scheduler(), range, out, pred);
+}
+template<typename Range, typename Pred>
+decltype(std::begin(std::declval<Range&>())) parallel_remove_if(Range&& range, const Pred& pred)
+{
+	return async::parallel_remove_if(::async::default_scheduler(), range, pred);
+}
+template<typename Range, typename Pred>
+decltype(std::begin(std::declval<Range&>())) parallel_partition(Range&& range, const Pred& pred)
+{
+	return async::parallel_partition(::async::default_scheduler(), range, pred);
+}
+template<typename Range, typename Pred>
+decltype(std::begin(std::declval<Range&>())) parallel_stable_partition(Range&& range, const Pred& pred)
+{
+	return async::parallel_stable_partition(::async::default_scheduler(), range, pred);
+}
+
+} // namespace async
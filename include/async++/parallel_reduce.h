@@ -34,77 +34,147 @@ struct default_map {
 	}
 };
 
+// Wrapper around a function which produces the identity value of a reduction.
+// Each leaf of the reduction calls this function instead of copying an initial
+// value, which allows large or move-only result types to be used.
+template<typename Func>
+struct identity_factory {
+	Func func;
+
+	typedef typename std::decay<decltype(std::declval<const Func&>()())>::type result_type;
+	result_type operator()() const
+	{
+		return func();
+	}
+};
+
+// Identity function which returns a copy of an initial value
+template<typename Result>
+struct copy_identity {
+	const Result& value;
+
+	typedef Result result_type;
+	Result operator()() const
+	{
+		return value;
+	}
+};
+
+// Result type of a reduction given its initial value or identity factory
+template<typename Result>
+struct reduce_result {
+	typedef Result type;
+};
+template<typename Func>
+struct reduce_result<identity_factory<Func>> {
+	typedef typename identity_factory<Func>::result_type type;
+};
+
+// Convert an initial value or identity factory to an identity function
+template<typename Result>
+copy_identity<Result> to_identity(const Result& init)
+{
+	return {init};
+}
+template<typename Func>
+const identity_factory<Func>& to_identity(const identity_factory<Func>& identity)
+{
+	return identity;
+}
+
 // Internal implementation of parallel_map_reduce that only accepts a
-// partitioner argument.
-template<typename Sched, typename Partitioner, typename Result, typename MapFunc, typename ReduceFunc>
-Result internal_parallel_map_reduce(Sched& sched, Partitioner partitioner, Result init, const MapFunc& map, const ReduceFunc& reduce)
+// partitioner argument. Partial results are moved up the tree, so the only
+// copies of the result are the ones made by the identity function at each leaf.
+template<typename Sched, typename Partitioner, typename Identity, typename MapFunc, typename ReduceFunc>
+typename Identity::result_type internal_parallel_map_reduce(Sched& sched, Partitioner partitioner, const Identity& identity, const MapFunc& map, const ReduceFunc& reduce)
 {
+	typedef typename Identity::result_type Result;
+
 	// Split the partition, run inline if no more splits are possible
 	auto subpart = partitioner.split();
 	if (subpart.begin() == subpart.end()) {
-		Result out = init;
-		for (auto&& i: partitioner)
-			out = reduce(std::move(out), map(std::forward<decltype(i)>(i)));
+		auto&& m = detail::leaf_function(map);
+		auto&& r = detail::leaf_function(reduce);
+		Result out = identity();
+		do {
+			for (auto&& i: partitioner)
+				out = r(std::move(out), m(std::forward<decltype(i)>(i)));
+		} while (detail::next_chunk(partitioner));
+
+		// Split whatever a chunked partitioner has left over
+		if (detail::has_remaining_chunks(partitioner))
+			out = reduce(std::move(out), detail::internal_parallel_map_reduce(sched, std::move(partitioner), identity, map, reduce));
 		return out;
 	}
 
 	// Run the function over each half in parallel
-	auto&& t = async::local_spawn(sched, [&sched, &subpart, init, &map, &reduce] {
-		return detail::internal_parallel_map_reduce(sched, std::move(subpart), init, map, reduce);
+	auto&& child_sched = detail::child_scheduler(sched, subpart);
+	auto&& t = async::local_spawn(child_sched, [&sched, &subpart, &identity, &map, &reduce] {
+		return detail::internal_parallel_map_reduce(sched, std::move(subpart), identity, map, reduce);
 	});
-	Result out = detail::internal_parallel_map_reduce(sched, std::move(partitioner), init, map, reduce);
+	Result out = detail::internal_parallel_map_reduce(sched, std::move(partitioner), identity, map, reduce);
 	return reduce(std::move(out), t.get());
 }
 
 } // namespace detail
 
-// Run a function for each element in a range and then reduce the results of that function to a single value
+// Create an identity factory for use as the initial value of a reduction. The
+// function is called once for each leaf of the reduction to create a fresh
+// accumulator, instead of copying an initial value.
+template<typename Func>
+detail::identity_factory<typename std::decay<Func>::type> make_identity(Func&& func)
+{
+	return {std::forward<Func>(func)};
+}
+
+// Run a function for each element in a range and then reduce the results of that function to a single value.
+// The initial value can either be a value or an identity factory created by make_identity().
 template<typename Sched, typename Range, typename Result, typename MapFunc, typename ReduceFunc>
-Result parallel_map_reduce(Sched& sched, Range&& range, Result init, const MapFunc& map, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_map_reduce(Sched& sched, Range&& range, Result init, const MapFunc& map, const ReduceFunc& reduce)
 {
-	return detail::internal_parallel_map_reduce(sched, async::to_partitioner(std::forward<Range>(range)), init, map, reduce);
+	return detail::internal_parallel_map_reduce(sched, async::to_partitioner(std::forward<Range>(range)), detail::to_identity(init), map, reduce);
 }
 
 // Overload with default scheduler
 template<typename Range, typename Result, typename MapFunc, typename ReduceFunc>
-Result parallel_map_reduce(Range&& range, Result init, const MapFunc& map, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_map_reduce(Range&& range, Result init, const MapFunc& map, const ReduceFunc& reduce)
 {
-	return async::parallel_map_reduce(::async::default_scheduler(), range, init, map, reduce);
+	return async::parallel_map_reduce(::async::default_scheduler(), range, std::move(init), map, reduce);
 }
 
 // Overloads with std::initializer_list
 template<typename Sched, typename T, typename Result, typename MapFunc, typename ReduceFunc>
-Result parallel_map_reduce(Sched& sched, std::initializer_list<T> range, Result init, const MapFunc& map, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_map_reduce(Sched& sched, std::initializer_list<T> range, Result init, const MapFunc& map, const ReduceFunc& reduce)
 {
-	return async::parallel_map_reduce(sched, async::make_range(range.begin(), range.end()), init, map, reduce);
+	return async::parallel_map_reduce(sched, async::make_range(range.begin(), range.end()), std::move(init), map, reduce);
 }
 template<typename T, typename Result, typename MapFunc, typename ReduceFunc>
-Result parallel_map_reduce(std::initializer_list<T> range, Result init, const MapFunc& map, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_map_reduce(std::initializer_list<T> range, Result init, const MapFunc& map, const ReduceFunc& reduce)
 {
-	return async::parallel_map_reduce(async::make_range(range.begin(), range.end()), init, map, reduce);
+	return async::parallel_map_reduce(async::make_range(range.begin(), range.end()), std::move(init), map, reduce);
 }
 
 // Variant with identity map operation
 template<typename Sched, typename Range, typename Result, typename ReduceFunc>
-Result parallel_reduce(Sched& sched, Range&& range, Result init, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_reduce(Sched& sched, Range&& range, Result init, const ReduceFunc& reduce)
 {
-	return async::parallel_map_reduce(sched, range, init, detail::default_map(), reduce);
+	return async::parallel_map_reduce(sched, range, std::move(init), detail::default_map(), reduce);
 }
 // 入口函数，提供range，初始值，和一个reduce function
 template<typename Range, typename Result, typename ReduceFunc>
-Result parallel_reduce(Range&& range, Result init, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_reduce(Range&& range, Result init, const ReduceFunc& reduce)
 {
-	return async::parallel_reduce(::async::default_scheduler(), range, init, reduce);
+	return async::parallel_reduce(::async::default_scheduler(), range, std::move(init), reduce);
 }
 template<typename Sched, typename T, typename Result, typename ReduceFunc>
-Result parallel_reduce(Sched& sched, std::initializer_list<T> range, Result init, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_reduce(Sched& sched, std::initializer_list<T> range, Result init, const ReduceFunc& reduce)
 {
-	return async::parallel_reduce(sched, async::make_range(range.begin(), range.end()), init, reduce);
+	return async::parallel_reduce(sched, async::make_range(range.begin(), range.end()), std::move(init), reduce);
 }
 template<typename T, typename Result, typename ReduceFunc>
-Result parallel_reduce(std::initializer_list<T> range, Result init, const ReduceFunc& reduce)
+typename detail::reduce_result<Result>::type parallel_reduce(std::initializer_list<T> range, Result init, const ReduceFunc& reduce)
 {
-	return async::parallel_reduce(async::make_range(range.begin(), range.end()), init, reduce);
+	return async::parallel_reduce(async::make_range(range.begin(), range.end()), std::move(init), reduce);
 }
 
 } // namespace async
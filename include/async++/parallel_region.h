@@ -0,0 +1,273 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Number of times a thread spins on a team barrier before it starts yielding
+const unsigned team_barrier_spin = 1024;
+
+// Shared state of a parallel region
+struct team_state {
+	std::size_t size;
+
+	// Sense-reversing barrier: the last thread to arrive resets the count and
+	// flips the sense, which releases all the other threads.
+	std::atomic<std::size_t> barrier_count;
+	std::atomic<bool> barrier_sense;
+
+	// Iteration counters for dynamic loops. Consecutive loops alternate
+	// between the two counters, so that one can be reset while the other one
+	// is in use.
+	std::atomic<std::size_t> counters[2];
+
+	// First exception thrown by any thread, after which the region is aborted
+	std::atomic<bool> aborted;
+	std::mutex lock;
+	std::exception_ptr except;
+
+	explicit team_state(std::size_t size)
+		: size(size), barrier_count(size), barrier_sense(false), aborted(false)
+	{
+		counters[0].store(0, std::memory_order_relaxed);
+		counters[1].store(0, std::memory_order_relaxed);
+	}
+};
+
+// Holds the region lock of a thread pool while a parallel region runs on it
+class region_guard {
+	threadpool_scheduler& sched;
+	bool owned;
+
+public:
+	explicit region_guard(threadpool_scheduler& sched)
+		: sched(sched), owned(detail::begin_region(sched)) {}
+	~region_guard()
+	{
+		if (owned)
+			detail::end_region(sched);
+	}
+	region_guard(const region_guard&) = delete;
+	region_guard& operator=(const region_guard&) = delete;
+
+	// Whether the region can use the whole pool, otherwise it is nested in
+	// another region or in a task of the pool and runs on one thread
+	bool owns_pool() const
+	{
+		return owned;
+	}
+};
+
+} // namespace detail
+
+// Handle passed to each thread of a parallel region, giving its rank in the
+// team and the operations which need the whole team to take part. All threads
+// must call barrier() and the loop functions in the same order. Each loop ends
+// with a barrier, and calls the function once for each index in [begin, end).
+class team_context {
+	detail::team_state& state;
+	std::size_t team_rank;
+	bool sense;
+	std::size_t num_dynamic_loops;
+
+	template<typename Func>
+	friend void parallel_region(threadpool_scheduler& sched, const Func& func);
+
+	team_context(detail::team_state& state, std::size_t rank)
+		: state(state), team_rank(rank), sense(false), num_dynamic_loops(0) {}
+
+	// Get the counter for the next dynamic loop, resetting the other one
+	std::atomic<std::size_t>& next_counter()
+	{
+		std::size_t index = num_dynamic_loops++ & 1;
+		if (team_rank == 0)
+			state.counters[index ^ 1].store(0, std::memory_order_relaxed);
+		return state.counters[index];
+	}
+
+public:
+	team_context(const team_context&) = delete;
+	team_context& operator=(const team_context&) = delete;
+
+	// Index of this thread in the team, and number of threads in the team
+	std::size_t rank() const
+	{
+		return team_rank;
+	}
+	std::size_t size() const
+	{
+		return state.size;
+	}
+
+	// Wait for all threads of the team to reach the barrier. This throws
+	// task_canceled if another thread of the team has thrown an exception.
+	void barrier()
+	{
+		sense = !sense;
+		if (state.barrier_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			state.barrier_count.store(state.size, std::memory_order_relaxed);
+			state.barrier_sense.store(sense, std::memory_order_release);
+			return;
+		}
+		for (unsigned i = 0; state.barrier_sense.load(std::memory_order_acquire) != sense; i++) {
+			if (state.aborted.load(std::memory_order_relaxed))
+				LIBASYNC_THROW(task_canceled());
+			if (i >= detail::team_barrier_spin)
+				std::this_thread::yield();
+		}
+	}
+
+	// Loop where each thread takes one contiguous block of the indices
+	template<typename T, typename Func>
+	void for_static(T begin, T end, const Func& func)
+	{
+		std::size_t length = end > begin ? static_cast<std::size_t>(end - begin) : 0;
+		T first = begin + static_cast<T>(length * team_rank / state.size);
+		T last = begin + static_cast<T>(length * (team_rank + 1) / state.size);
+		for (T i = first; i != last; ++i)
+			func(i);
+		barrier();
+	}
+
+	// Loop where chunks of the given size are dealt out to the threads in
+	// round-robin order
+	template<typename T, typename Func>
+	void for_static(T begin, T end, std::size_t chunk, const Func& func)
+	{
+		std::size_t length = end > begin ? static_cast<std::size_t>(end - begin) : 0;
+		if (chunk == 0)
+			chunk = 1;
+		for (std::size_t start = team_rank * chunk; start < length; start += state.size * chunk) {
+			T last = begin + static_cast<T>(std::min(start + chunk, length));
+			for (T i = begin + static_cast<T>(start); i != last; ++i)
+				func(i);
+		}
+		barrier();
+	}
+
+	// Loop where threads take chunks of the given size from a shared counter
+	// until all indices have been claimed
+	template<typename T, typename Func>
+	void for_dynamic(T begin, T end, std::size_t chunk, const Func& func)
+	{
+		std::size_t length = end > begin ? static_cast<std::size_t>(end - begin) : 0;
+		std::atomic<std::size_t>& counter = next_counter();
+		if (chunk == 0)
+			chunk = 1;
+		while (true) {
+			std::size_t start = counter.fetch_add(chunk, std::memory_order_relaxed);
+			if (start >= length)
+				break;
+			T last = begin + static_cast<T>(std::min(start + chunk, length));
+			for (T i = begin + static_cast<T>(start); i != last; ++i)
+				func(i);
+		}
+		barrier();
+	}
+
+	// Loop where threads take chunks from a shared counter, with the chunk
+	// size proportional to the number of remaining indices but no smaller than
+	// the given minimum
+	template<typename T, typename Func>
+	void for_guided(T begin, T end, std::size_t min_chunk, const Func& func)
+	{
+		std::size_t length = end > begin ? static_cast<std::size_t>(end - begin) : 0;
+		std::atomic<std::size_t>& counter = next_counter();
+		if (min_chunk == 0)
+			min_chunk = 1;
+		std::size_t start = counter.load(std::memory_order_relaxed);
+		while (start < length) {
+			std::size_t chunk = std::max(min_chunk, (length - start) / (2 * state.size));
+			std::size_t last_index = std::min(start + chunk, length);
+			if (!counter.compare_exchange_weak(start, last_index, std::memory_order_relaxed))
+				continue;
+			T last = begin + static_cast<T>(last_index);
+			for (T i = begin + static_cast<T>(start); i != last; ++i)
+				func(i);
+			start = counter.load(std::memory_order_relaxed);
+		}
+		barrier();
+	}
+};
+
+// Run a function on every thread of a thread pool at once, in the style of an
+// OpenMP parallel region. The calling thread takes part as rank 0 and the other
+// ranks are sent to the mailboxes of other threads of the pool, so the
+// function should only be used on a pool which isn't busy with long-running
+// tasks. Regions started from outside the pool run one at a time. A region
+// started while another one is running on the pool, from one of its ranks or
+// from a task of the pool, runs on the calling thread alone with a team size of
+// 1. If the function throws on any thread, the other threads are released from
+// their barriers and the first exception is rethrown.
+template<typename Func>
+void parallel_region(threadpool_scheduler& sched, const Func& func)
+{
+	detail::region_guard guard(sched);
+	std::size_t size = guard.owns_pool() ? sched.num_threads() : 1;
+	if (size == 0)
+		size = 1;
+	detail::team_state state(size);
+
+	auto run = [&state, &func](std::size_t rank) {
+		team_context context(state, rank);
+		LIBASYNC_TRY {
+			func(context);
+		} LIBASYNC_CATCH(...) {
+			std::lock_guard<std::mutex> locked(state.lock);
+			if (!state.except)
+				state.except = std::current_exception();
+			state.aborted.store(true, std::memory_order_relaxed);
+		}
+	};
+
+	// Send each of the other ranks to a different thread, skipping the current
+	// thread if it is part of the pool.
+	std::size_t current = sched.current_thread_index();
+	std::vector<task<void>> ranks;
+	ranks.reserve(size - 1);
+	for (std::size_t rank = 1, thread = 0; rank < size; rank++, thread++) {
+		if (thread == current)
+			thread++;
+		detail::mailbox_scheduler target = {sched, thread};
+		ranks.push_back(async::spawn(target, [&run, rank] {
+			run(rank);
+		}));
+	}
+	run(0);
+	for (auto& t: ranks)
+		t.get();
+
+	if (state.except)
+		LIBASYNC_RETHROW_EXCEPTION(state.except);
+}
+
+// Overload with default thread pool
+template<typename Func>
+void parallel_region(const Func& func)
+{
+	async::parallel_region(::async::default_threadpool_scheduler(), func);
+}
+
+} // namespace async
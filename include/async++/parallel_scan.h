@@ -0,0 +1,168 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Determine the block size used by multi-pass algorithms such as scans. A few
+// blocks are created for each thread so that the passes are load balanced,
+// while keeping the number of blocks small enough that the per-block totals
+// can be combined serially.
+inline std::size_t scan_block_size(std::size_t length)
+{
+	std::size_t num_blocks = 4 * hardware_concurrency();
+	std::size_t block = (length + num_blocks - 1) / num_blocks;
+	if (block < 2048)
+		block = 2048;
+	return block;
+}
+
+// Get the boundaries of each block of a sequence. The result contains one more
+// iterator than the number of blocks, the last one being the end of the
+// sequence. For random-access iterators this only takes one step per block.
+template<typename Iter>
+std::vector<Iter> block_boundaries(Iter begin, std::size_t length, std::size_t block)
+{
+	std::vector<Iter> out;
+	out.reserve((length + block - 1) / block + 1);
+	out.push_back(begin);
+	while (length != 0) {
+		std::size_t step = length < block ? length : block;
+		std::advance(begin, step);
+		out.push_back(begin);
+		length -= step;
+	}
+	return out;
+}
+
+// Internal implementation of the scan algorithms. This uses the classic
+// two-pass approach: first the total of each block is computed in parallel,
+// then the block totals are combined serially into the carry-in value for each
+// block, and finally each block is scanned in parallel starting from its
+// carry-in value. An element is always read before its output is written, so
+// the output may alias the input.
+template<typename Sched, typename Iter, typename OutIter, typename T, typename BinaryOp>
+OutIter internal_parallel_scan(Sched& sched, Iter begin, Iter end, OutIter out, const BinaryOp& op, const T* init, bool exclusive)
+{
+	std::size_t length = std::distance(begin, end);
+	if (length == 0)
+		return out;
+	std::size_t block = detail::scan_block_size(length);
+	std::vector<Iter> in_blocks = detail::block_boundaries(begin, length, block);
+	std::vector<OutIter> out_blocks = detail::block_boundaries(out, length, block);
+	std::size_t num_blocks = in_blocks.size() - 1;
+
+	// Compute the total of each block, except the last one which isn't needed
+	std::vector<T> carry(num_blocks - 1, init ? *init : T(*begin));
+	async::parallel_for(sched, async::irange(std::size_t(0), num_blocks - 1), [&in_blocks, &carry, &op](std::size_t i) {
+		Iter it = in_blocks[i];
+		T sum = *it;
+		for (++it; it != in_blocks[i + 1]; ++it)
+			sum = op(std::move(sum), *it);
+		carry[i] = std::move(sum);
+	});
+
+	// Turn the block totals into the carry-in value of the following block
+	for (std::size_t i = 0; i < carry.size(); i++) {
+		if (i != 0)
+			carry[i] = op(carry[i - 1], std::move(carry[i]));
+		else if (init)
+			carry[i] = op(*init, std::move(carry[i]));
+	}
+
+	// Scan each block starting from its carry-in value
+	async::parallel_for(sched, async::irange(std::size_t(0), num_blocks), [&in_blocks, &out_blocks, &carry, &op, init, exclusive](std::size_t i) {
+		Iter it = in_blocks[i];
+		OutIter o = out_blocks[i];
+		const T* carry_in = i == 0 ? init : &carry[i - 1];
+		if (exclusive) {
+			T sum = *carry_in;
+			for (; it != in_blocks[i + 1]; ++it, ++o) {
+				T next = op(sum, *it);
+				*o = std::move(sum);
+				sum = std::move(next);
+			}
+		} else {
+			T sum = carry_in ? op(*carry_in, *it) : T(*it);
+			*o = sum;
+			for (++it, ++o; it != in_blocks[i + 1]; ++it, ++o) {
+				sum = op(std::move(sum), *it);
+				*o = sum;
+			}
+		}
+	});
+
+	return out_blocks.back();
+}
+
+} // namespace detail
+
+// Compute the inclusive prefix sum of a range with an associative operation
+// and write it to an output sequence, returning the end of the output. The
+// output iterator must be a forward iterator, and may be the beginning of the
+// input range to perform the scan in-place.
+template<typename Sched, typename Range, typename OutIter, typename BinaryOp>
+typename std::enable_if<detail::is_scheduler<Sched>::value, OutIter>::type
+parallel_inclusive_scan(Sched& sched, Range&& range, OutIter out, const BinaryOp& op)
+{
+	typedef typename std::iterator_traits<decltype(std::begin(range))>::value_type value_type;
+	return detail::internal_parallel_scan(sched, std::begin(range), std::end(range), out, op, static_cast<const value_type*>(nullptr), false);
+}
+
+// Inclusive scan where init is combined with the first element
+template<typename Sched, typename Range, typename OutIter, typename BinaryOp, typename T>
+OutIter parallel_inclusive_scan(Sched& sched, Range&& range, OutIter out, const BinaryOp& op, T init)
+{
+	return detail::internal_parallel_scan(sched, std::begin(range), std::end(range), out, op, &init, false);
+}
+
+// Compute the exclusive prefix sum of a range with an associative operation.
+// The first output element is init and the sum of the last element is not
+// included in the output.
+template<typename Sched, typename Range, typename OutIter, typename T, typename BinaryOp>
+OutIter parallel_exclusive_scan(Sched& sched, Range&& range, OutIter out, T init, const BinaryOp& op)
+{
+	return detail::internal_parallel_scan(sched, std::begin(range), std::end(range), out, op, &init, true);
+}
+
+// Overloads with default scheduler
+template<typename Range, typename OutIter, typename BinaryOp>
+OutIter parallel_inclusive_scan(Range&& range, OutIter out, const BinaryOp& op)
+{
+	return async::parallel_inclusive_scan(::async::default_scheduler(), range, out, op);
+}
+template<typename Range, typename OutIter, typename BinaryOp, typename T>
+typename std::enable_if<!detail::is_scheduler<typename std::decay<Range>::type>::value, OutIter>::type
+parallel_inclusive_scan(Range&& range, OutIter out, const BinaryOp& op, T init)
+{
+	return async::parallel_inclusive_scan(::async::default_scheduler(), range, out, op, std::move(init));
+}
+template<typename Range, typename OutIter, typename T, typename BinaryOp>
+OutIter parallel_exclusive_scan(Range&& range, OutIter out, T init, const BinaryOp& op)
+{
+	return async::parallel_exclusive_scan(::async::default_scheduler(), range, out, std::move(init), op);
+}
+
+} // namespace async
@@ -0,0 +1,231 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+namespace detail {
+
+// Determine the size below which a sequence is sorted serially. This creates
+// a few leaves per thread, which keeps the number of merge passes low.
+inline std::size_t sort_cutoff(std::size_t length)
+{
+	std::size_t cutoff = length / (4 * hardware_concurrency());
+	if (cutoff < 2048)
+		cutoff = 2048;
+	return cutoff;
+}
+
+// Merge sort a sequence using buffer as scratch space of the same length. The
+// two halves are sorted recursively into the opposite array, so that merging
+// them puts the result where it is wanted: back into the input if in_place is
+// set, or into the buffer otherwise.
+template<typename Sched, typename Iter, typename Buffer, typename Compare, typename LeafSort>
+void parallel_sort_step(Sched& sched, Iter begin, Iter end, Buffer buffer, const Compare& comp, const LeafSort& leaf_sort, std::size_t cutoff, bool in_place)
+{
+	std::size_t length = end - begin;
+	if (length <= cutoff) {
+		leaf_sort(begin, end, comp);
+		if (!in_place)
+			std::move(begin, end, buffer);
+		return;
+	}
+
+	Iter mid = begin + length / 2;
+	Buffer buffer_mid = buffer + length / 2;
+	Buffer buffer_end = buffer + length;
+	{
+		auto&& t = async::local_spawn(sched, [&sched, mid, end, buffer_mid, &comp, &leaf_sort, cutoff, in_place] {
+			detail::parallel_sort_step(sched, mid, end, buffer_mid, comp, leaf_sort, cutoff, !in_place);
+		});
+		detail::parallel_sort_step(sched, begin, mid, buffer, comp, leaf_sort, cutoff, !in_place);
+		t.get();
+	}
+	if (in_place)
+		detail::internal_parallel_merge(sched, std::make_move_iterator(buffer), std::make_move_iterator(buffer_mid), std::make_move_iterator(buffer_mid), std::make_move_iterator(buffer_end), begin, comp);
+	else
+		detail::internal_parallel_merge(sched, std::make_move_iterator(begin), std::make_move_iterator(mid), std::make_move_iterator(mid), std::make_move_iterator(end), buffer, comp);
+}
+
+// Temporary buffer whose elements are move constructed from a sequence and
+// destroyed in parallel. This is used by algorithms which need to move the
+// elements of a sequence out of the way before putting them back in a new
+// order.
+template<typename Sched, typename T>
+class move_buffer {
+	Sched& sched;
+	T* ptr;
+	std::size_t length;
+
+public:
+	template<typename Iter>
+	move_buffer(Sched& sched, Iter begin, std::size_t n)
+		: sched(sched), ptr(static_cast<T*>(aligned_alloc(n * sizeof(T), LIBASYNC_CACHELINE_SIZE))), length(0)
+	{
+		LIBASYNC_TRY {
+			construct(begin, n, std::is_nothrow_move_constructible<T>());
+		} LIBASYNC_CATCH(...) {
+			aligned_free(ptr);
+			LIBASYNC_RETHROW();
+		}
+		length = n;
+	}
+	~move_buffer()
+	{
+		T* p = ptr;
+		async::parallel_for(sched, async::irange(std::size_t(0), length), [p](std::size_t i) {
+			p[i].~T();
+		});
+		aligned_free(ptr);
+	}
+
+	// Non-copyable and non-movable
+	move_buffer(const move_buffer&) = delete;
+	move_buffer& operator=(const move_buffer&) = delete;
+
+	T* get() const
+	{
+		return ptr;
+	}
+
+private:
+	// If the move constructor can't throw then construct in parallel
+	template<typename Iter>
+	void construct(Iter begin, std::size_t n, std::true_type)
+	{
+		T* p = ptr;
+		async::parallel_for(sched, async::irange(std::size_t(0), n), [p, begin](std::size_t i) {
+			new(p + i) T(std::move(begin[i]));
+		});
+	}
+
+	// Otherwise construct serially so that we can clean up after an exception
+	template<typename Iter>
+	void construct(Iter begin, std::size_t n, std::false_type)
+	{
+		std::size_t i;
+		LIBASYNC_TRY {
+			for (i = 0; i < n; i++)
+				new(ptr + i) T(std::move(begin[i]));
+		} LIBASYNC_CATCH(...) {
+			for (std::size_t j = 0; j < i; j++)
+				ptr[j].~T();
+			LIBASYNC_RETHROW();
+		}
+	}
+};
+
+// Serial sort functions used for the leaves of a parallel sort
+struct unstable_leaf_sort {
+	template<typename Iter, typename Compare>
+	void operator()(Iter begin, Iter end, const Compare& comp) const
+	{
+		std::sort(begin, end, comp);
+	}
+};
+struct stable_leaf_sort {
+	template<typename Iter, typename Compare>
+	void operator()(Iter begin, Iter end, const Compare& comp) const
+	{
+		std::stable_sort(begin, end, comp);
+	}
+};
+
+// Internal implementation of the parallel sorts
+template<typename Sched, typename Iter, typename Compare, typename LeafSort>
+void internal_parallel_sort(Sched& sched, Iter begin, Iter end, const Compare& comp, const LeafSort& leaf_sort)
+{
+	typedef typename std::iterator_traits<Iter>::value_type value_type;
+
+	// Small sequences are sorted serially without allocating a buffer
+	std::size_t length = std::distance(begin, end);
+	std::size_t cutoff = detail::sort_cutoff(length);
+	if (length <= cutoff) {
+		leaf_sort(begin, end, comp);
+		return;
+	}
+
+	// The elements are moved into the buffer and sorted from there back into
+	// the original sequence, which is used as the scratch space.
+	move_buffer<Sched, value_type> buffer(sched, begin, length);
+	detail::parallel_sort_step(sched, buffer.get(), buffer.get() + length, begin, comp, leaf_sort, cutoff, false);
+}
+
+} // namespace detail
+
+// Sort a sequence in parallel. This is a merge sort in which the leaves are
+// sorted with std::sort, and which requires random-access iterators and a
+// temporary buffer the size of the sequence. If the comparison function throws
+// an exception, the contents of the sequence are unspecified.
+template<typename Sched, typename Iter, typename Compare>
+typename std::enable_if<detail::is_scheduler<Sched>::value>::type
+parallel_sort(Sched& sched, Iter begin, Iter end, const Compare& comp)
+{
+	detail::internal_parallel_sort(sched, begin, end, comp, detail::unstable_leaf_sort());
+}
+template<typename Sched, typename Iter>
+typename std::enable_if<detail::is_scheduler<Sched>::value>::type
+parallel_sort(Sched& sched, Iter begin, Iter end)
+{
+	async::parallel_sort(sched, begin, end, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+// Sort a sequence in parallel while preserving the order of equal elements
+template<typename Sched, typename Iter, typename Compare>
+typename std::enable_if<detail::is_scheduler<Sched>::value>::type
+parallel_stable_sort(Sched& sched, Iter begin, Iter end, const Compare& comp)
+{
+	detail::internal_parallel_sort(sched, begin, end, comp, detail::stable_leaf_sort());
+}
+template<typename Sched, typename Iter>
+typename std::enable_if<detail::is_scheduler<Sched>::value>::type
+parallel_stable_sort(Sched& sched, Iter begin, Iter end)
+{
+	async::parallel_stable_sort(sched, begin, end, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+// Overloads with default scheduler
+template<typename Iter, typename Compare>
+typename std::enable_if<!detail::is_scheduler<Iter>::value>::type
+parallel_sort(Iter begin, Iter end, const Compare& comp)
+{
+	async::parallel_sort(::async::default_scheduler(), begin, end, comp);
+}
+template<typename Iter>
+void parallel_sort(Iter begin, Iter end)
+{
+	async::parallel_sort(::async::default_scheduler(), begin, end);
+}
+template<typename Iter, typename Compare>
+typename std::enable_if<!detail::is_scheduler<Iter>::value>::type
+parallel_stable_sort(Iter begin, Iter end, const Compare& comp)
+{
+	async::parallel_stable_sort(::async::default_scheduler(), begin, end, comp);
+}
+template<typename Iter>
+void parallel_stable_sort(Iter begin, Iter end)
+{
+	async::parallel_stable_sort(::async::default_scheduler(), begin, end);
+}
+
+} // namespace async
@@ -30,6 +30,27 @@ namespace detail {
 // child task and modifies the parent partitioner's range to represent the rest
 // of the original range. If the range cannot be split any more then split()
 // should return an empty range.
+//
+// Splittable ranges also have a split() function, but they decide for
+// themselves how to split and leave the decision of whether to split to a
+// partitioner. is_divisible() returns whether the range can be split, in which
+// case split() returns the second half of the range and modifies the range to
+// represent the first half.
+//
+// A partitioner can also hand out its range one chunk at a time instead of
+// running it all at once when it is not split. In that case begin() and end()
+// only cover the current chunk, and next_chunk() is called once it has been
+// processed. next_chunk() returns true to run the next chunk inline. If it
+// returns false with some of the range left over, the rest of the range should
+// be split again.
+
+// Detect whether a range is a splittable range
+template<typename T, typename = decltype(std::declval<const T&>().is_divisible())>
+two& is_splittable_range_helper(int);
+template<typename T>
+one& is_splittable_range_helper(...);
+template<typename T>
+struct is_splittable_range: public std::integral_constant<bool, sizeof(is_splittable_range_helper<T>(0)) - 1> {};
 
 // Detect whether a range is a partitioner
 template<typename T, typename = decltype(std::declval<T>().split())>
@@ -37,7 +58,55 @@ two& is_partitioner_helper(int);
 template<typename T>
 one& is_partitioner_helper(...);
 template<typename T>
-struct is_partitioner: public std::integral_constant<bool, sizeof(is_partitioner_helper<T>(0)) - 1> {};
+struct is_partitioner: public std::integral_constant<bool, sizeof(is_partitioner_helper<T>(0)) - 1 && !is_splittable_range<T>::value> {};
+
+// Detect whether a partitioner hands out its range in chunks
+template<typename T, typename = decltype(std::declval<T&>().next_chunk())>
+two& is_chunked_partitioner_helper(int);
+template<typename T>
+one& is_chunked_partitioner_helper(...);
+template<typename T>
+struct is_chunked_partitioner: public std::integral_constant<bool, sizeof(is_chunked_partitioner_helper<T>(0)) - 1> {};
+
+// Move a partitioner on to its next chunk, if it has any
+template<typename Partitioner>
+typename std::enable_if<is_chunked_partitioner<Partitioner>::value, bool>::type next_chunk(Partitioner& partitioner)
+{
+	return partitioner.next_chunk();
+}
+template<typename Partitioner>
+typename std::enable_if<!is_chunked_partitioner<Partitioner>::value, bool>::type next_chunk(Partitioner&)
+{
+	return false;
+}
+
+// Check whether a chunked partitioner stopped with part of its range left over
+template<typename Partitioner>
+bool has_remaining_chunks(const Partitioner& partitioner)
+{
+	return is_chunked_partitioner<Partitioner>::value && partitioner.begin() != partitioner.end();
+}
+
+// Detect whether a partitioner keeps track of its length
+template<typename T, typename = decltype(std::declval<const T&>().size())>
+two& has_size_helper(int);
+template<typename T>
+one& has_size_helper(...);
+template<typename T>
+struct has_size: public std::integral_constant<bool, sizeof(has_size_helper<T>(0)) - 1> {};
+
+// Get the number of elements in a partitioner, which only walks its range if
+// the partitioner doesn't know its length
+template<typename Partitioner>
+typename std::enable_if<has_size<Partitioner>::value, std::size_t>::type partitioner_size(const Partitioner& partitioner)
+{
+	return partitioner.size();
+}
+template<typename Partitioner>
+typename std::enable_if<!has_size<Partitioner>::value, std::size_t>::type partitioner_size(const Partitioner& partitioner)
+{
+	return std::distance(partitioner.begin(), partitioner.end());
+}
 
 // Automatically determine a grain size for a sequence length
 inline std::size_t auto_grain_size(std::size_t dist)
@@ -54,11 +123,14 @@ inline std::size_t auto_grain_size(std::size_t dist)
 template<typename Iter>
 class static_partitioner_impl {
 	Iter iter_begin, iter_end;
+	std::size_t length;
 	std::size_t grain;
 
 public:
 	static_partitioner_impl(Iter begin, Iter end, std::size_t grain)
-		: iter_begin(begin), iter_end(end), grain(grain) {}
+		: iter_begin(begin), iter_end(end), length(std::distance(begin, end)), grain(grain) {}
+	static_partitioner_impl(Iter begin, Iter end, std::size_t length, std::size_t grain)
+		: iter_begin(begin), iter_end(end), length(length), grain(grain) {}
 	Iter begin() const
 	{
 		return iter_begin;
@@ -67,11 +139,14 @@ public:
 	{
 		return iter_end;
 	}
+	std::size_t size() const
+	{
+		return length;
+	}
 	static_partitioner_impl split()
 	{
 		// Don't split if below grain size
-		std::size_t length = std::distance(iter_begin, iter_end);
-		static_partitioner_impl out(iter_end, iter_end, grain);
+		static_partitioner_impl out(iter_end, iter_end, 0, grain);
 		if (length <= grain)
 			return out;
 
@@ -79,6 +154,8 @@ public:
 		iter_end = iter_begin;
 		std::advance(iter_end, (length + 1) / 2);
 		out.iter_begin = iter_end;
+		out.length = length / 2;
+		length -= out.length;
 		return out;
 	}
 };
@@ -86,6 +163,7 @@ public:
 template<typename Iter>
 class auto_partitioner_impl {
 	Iter iter_begin, iter_end;
+	std::size_t length;
 	std::size_t grain;
 	std::size_t num_threads;
 	std::thread::id last_thread;
@@ -93,7 +171,9 @@ class auto_partitioner_impl {
 public:
 	// thread_id is initialized to "no thread" and will be set on first split
 	auto_partitioner_impl(Iter begin, Iter end, std::size_t grain)
-		: iter_begin(begin), iter_end(end), grain(grain) {}
+		: iter_begin(begin), iter_end(end), length(std::distance(begin, end)), grain(grain) {}
+	auto_partitioner_impl(Iter begin, Iter end, std::size_t length, std::size_t grain)
+		: iter_begin(begin), iter_end(end), length(length), grain(grain) {}
 	Iter begin() const
 	{
 		return iter_begin;
@@ -102,11 +182,14 @@ public:
 	{
 		return iter_end;
 	}
+	std::size_t size() const
+	{
+		return length;
+	}
 	auto_partitioner_impl split()
 	{
 		// Don't split if below grain size
-		std::size_t length = std::distance(iter_begin, iter_end);
-		auto_partitioner_impl out(iter_end, iter_end, grain);
+		auto_partitioner_impl out(iter_end, iter_end, 0, grain);
 		if (length <= grain)
 			return out;
 
@@ -123,6 +206,412 @@ public:
 		iter_end = iter_begin;
 		std::advance(iter_end, (length + 1) / 2);
 		out.iter_begin = iter_end;
+		out.length = length / 2;
+		length -= out.length;
+		out.last_thread = current_thread;
+		last_thread = current_thread;
+		out.num_threads = num_threads / 2;
+		num_threads -= out.num_threads;
+		return out;
+	}
+};
+
+// Lazy partitioner which only splits its range when another thread could use
+// the work, and otherwise processes it in grain-sized chunks, checking again
+// before each chunk.
+template<typename Iter>
+class lazy_partitioner_impl {
+	Iter iter_begin, iter_end, chunk_end;
+	std::size_t length, chunk_length;
+	std::size_t grain;
+
+	void start_chunk()
+	{
+		chunk_length = std::min(grain, length);
+		chunk_end = iter_begin;
+		std::advance(chunk_end, chunk_length);
+	}
+
+public:
+	lazy_partitioner_impl(Iter begin, Iter end, std::size_t length, std::size_t grain)
+		: iter_begin(begin), iter_end(end), chunk_end(end), length(length), chunk_length(length), grain(grain) {}
+	Iter begin() const
+	{
+		return iter_begin;
+	}
+	Iter end() const
+	{
+		return chunk_end;
+	}
+	// Number of elements left, including those after the current chunk
+	std::size_t size() const
+	{
+		return length;
+	}
+	lazy_partitioner_impl split()
+	{
+		// Don't split if below grain size
+		lazy_partitioner_impl out(iter_end, iter_end, 0, grain);
+		chunk_end = iter_end;
+		chunk_length = length;
+		if (length <= grain)
+			return out;
+
+		// Run the range in chunks if no other thread needs work
+		if (!detail::work_requested()) {
+			start_chunk();
+			return out;
+		}
+
+		// Split our range in half
+		iter_end = iter_begin;
+		std::advance(iter_end, (length + 1) / 2);
+		out.iter_begin = iter_end;
+		out.length = out.chunk_length = length / 2;
+		length -= out.length;
+		chunk_end = iter_end;
+		chunk_length = length;
+		return out;
+	}
+	bool next_chunk()
+	{
+		iter_begin = chunk_end;
+		length -= chunk_length;
+		if (length == 0)
+			return false;
+
+		// Leave the rest of the range to be split if another thread needs work
+		if (length > grain && detail::work_requested()) {
+			chunk_end = iter_end;
+			chunk_length = length;
+			return false;
+		}
+		start_chunk();
+		return true;
+	}
+};
+
+// Estimate of the time taken per element by a loop body, shared by all parts
+// of an adaptive partitioner. Updates from different threads may race, which
+// only loses a sample.
+struct grain_estimate {
+	std::atomic<double> ns_per_element;
+
+	grain_estimate()
+		: ns_per_element(0) {}
+
+	// Samples are inflated whenever a thread is preempted in the middle of a
+	// leaf, so the estimate follows lower samples faster than higher ones.
+	void update(double elapsed_ns, std::size_t elements)
+	{
+		double sample = elapsed_ns / elements;
+		double current = ns_per_element.load(std::memory_order_relaxed);
+		if (current == 0)
+			current = sample;
+		else if (sample < current)
+			current = (current + sample) / 2;
+		else
+			current = (7 * current + sample) / 8;
+		ns_per_element.store(current, std::memory_order_relaxed);
+	}
+};
+
+// Leaves of an adaptive partitioner aim to take this long to run. This is long
+// enough to make the cost of a split negligible.
+const double adaptive_leaf_ns = 50000;
+
+// Partitioner which measures how long its leaves take and picks the grain size
+// for later splits so that each leaf takes about adaptive_leaf_ns. Until the
+// first measurement is available, leaves start by running a few chunks of
+// doubling size to time the loop body.
+template<typename Iter>
+class adaptive_partitioner_impl {
+	typedef std::chrono::steady_clock clock;
+
+	Iter iter_begin, iter_end, chunk_end;
+	std::size_t length, chunk_length;
+	std::size_t max_grain;
+	std::shared_ptr<grain_estimate> estimate;
+	clock::time_point start;
+	bool probing;
+
+	void start_chunk(std::size_t size)
+	{
+		chunk_length = std::min(size, length);
+		chunk_end = iter_begin;
+		std::advance(chunk_end, chunk_length);
+		start = clock::now();
+	}
+
+public:
+	adaptive_partitioner_impl(Iter begin, Iter end, std::size_t length, std::size_t max_grain, std::shared_ptr<grain_estimate> estimate)
+		: iter_begin(begin), iter_end(end), chunk_end(end), length(length), chunk_length(length), max_grain(max_grain), estimate(std::move(estimate)), probing(false) {}
+	Iter begin() const
+	{
+		return iter_begin;
+	}
+	Iter end() const
+	{
+		return chunk_end;
+	}
+	// Number of elements left, including those after the current chunk
+	std::size_t size() const
+	{
+		return length;
+	}
+	adaptive_partitioner_impl split()
+	{
+		adaptive_partitioner_impl out(iter_end, iter_end, 0, max_grain, estimate);
+		chunk_end = iter_end;
+		chunk_length = length;
+		if (length == 0)
+			return out;
+
+		// Time the loop body on a single element first if there is no
+		// estimate yet.
+		double cost = estimate->ns_per_element.load(std::memory_order_relaxed);
+		if (cost == 0) {
+			probing = true;
+			start_chunk(1);
+			return out;
+		}
+
+		// Don't split if below the grain size for the current estimate
+		double grain = adaptive_leaf_ns / cost;
+		if (grain > max_grain)
+			grain = static_cast<double>(max_grain);
+		if (length <= grain || length == 1) {
+			probing = false;
+			start_chunk(length);
+			return out;
+		}
+
+		// Split our range in half
+		iter_end = iter_begin;
+		std::advance(iter_end, (length + 1) / 2);
+		out.iter_begin = iter_end;
+		out.length = out.chunk_length = length / 2;
+		length -= out.length;
+		chunk_end = iter_end;
+		chunk_length = length;
+		return out;
+	}
+	bool next_chunk()
+	{
+		double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		iter_begin = chunk_end;
+		length -= chunk_length;
+
+		// Keep doubling the chunk size while probing until the time taken is
+		// long enough to measure reliably.
+		if (probing && elapsed < 1000 && length != 0) {
+			start_chunk(2 * chunk_length);
+			return true;
+		}
+		estimate->update(elapsed, chunk_length);
+		probing = false;
+
+		// Leave the rest of the range to be split using the new estimate
+		chunk_end = iter_end;
+		chunk_length = length;
+		return false;
+	}
+};
+
+// Record of which thread of a thread pool ran each part of a loop, used by
+// affinity_partitioner. Parts are numbered as nodes of a binary heap, where the
+// children of node n are 2n and 2n + 1, which is stable as long as the length
+// of the range doesn't change.
+struct affinity_map {
+	threadpool_scheduler* sched;
+	std::size_t length;
+	std::size_t grain;
+	std::vector<std::size_t> threads;
+
+	explicit affinity_map(threadpool_scheduler& sched)
+		: sched(&sched), length(0), grain(1) {}
+
+	// Start over with a range of a different length. The grain size gives
+	// each thread a few parts so that work can still be balanced.
+	void reset(std::size_t new_length)
+	{
+		std::size_t parts = 4 * sched->num_threads();
+		length = new_length;
+		grain = (length + parts - 1) / parts;
+		if (grain == 0)
+			grain = 1;
+
+		std::size_t leaves = 1;
+		for (std::size_t n = length; n > grain; n = (n + 1) / 2)
+			leaves *= 2;
+		threads.assign(2 * leaves, static_cast<std::size_t>(-1));
+	}
+
+	void record(std::size_t node)
+	{
+		if (node < threads.size())
+			threads[node] = sched->current_thread_index();
+	}
+	std::size_t thread(std::size_t node) const
+	{
+		return node < threads.size() ? threads[node] : static_cast<std::size_t>(-1);
+	}
+};
+
+// Partitioner which splits like a static partitioner, records the thread that
+// runs each part, and sends each part back to the same thread the next time.
+template<typename Iter>
+class affinity_partitioner_impl {
+	Iter iter_begin, iter_end;
+	std::size_t length;
+	std::size_t node;
+	affinity_map* map;
+
+public:
+	affinity_partitioner_impl(Iter begin, Iter end, std::size_t length, std::size_t node, affinity_map* map)
+		: iter_begin(begin), iter_end(end), length(length), node(node), map(map) {}
+	Iter begin() const
+	{
+		return iter_begin;
+	}
+	Iter end() const
+	{
+		return iter_end;
+	}
+	std::size_t size() const
+	{
+		return length;
+	}
+	affinity_partitioner_impl split()
+	{
+		// Remember which thread is running this part
+		map->record(node);
+
+		// Don't split if below grain size
+		affinity_partitioner_impl out(iter_end, iter_end, 0, 0, map);
+		if (length <= map->grain)
+			return out;
+
+		// Split our range in half
+		iter_end = iter_begin;
+		std::advance(iter_end, (length + 1) / 2);
+		out.iter_begin = iter_end;
+		out.length = length / 2;
+		length -= out.length;
+		out.node = 2 * node + 1;
+		node = 2 * node;
+		return out;
+	}
+
+	// Thread which ran this part last time
+	std::size_t preferred_thread(const threadpool_scheduler& sched) const
+	{
+		return &sched == map->sched ? map->thread(node) : static_cast<std::size_t>(-1);
+	}
+};
+
+// Scheduler which sends tasks to a particular thread of a thread pool
+struct mailbox_scheduler {
+	threadpool_scheduler& sched;
+	std::size_t thread;
+
+	void schedule(task_run_handle t)
+	{
+		sched.schedule_on(thread, std::move(t));
+	}
+};
+
+// Get the scheduler to spawn a child partition on. This is the scheduler given
+// to the algorithm except for partitioners which prefer a particular thread.
+template<typename Sched, typename Partitioner>
+Sched& child_scheduler(Sched& sched, const Partitioner&)
+{
+	return sched;
+}
+template<typename Iter>
+mailbox_scheduler child_scheduler(threadpool_scheduler& sched, const affinity_partitioner_impl<Iter>& partitioner)
+{
+	return {sched, partitioner.preferred_thread(sched)};
+}
+
+// Partitioners for splittable ranges. These follow the same strategies as the
+// ones above, but use the range's own split points and grain sizes. A range
+// which can't be split is returned as an empty partitioner.
+template<typename Range>
+class static_range_partitioner_impl {
+	Range range;
+	bool empty;
+
+public:
+	explicit static_range_partitioner_impl(Range range)
+		: range(std::move(range)), empty(false) {}
+	decltype(std::declval<const Range&>().begin()) begin() const
+	{
+		return empty ? range.end() : range.begin();
+	}
+	decltype(std::declval<const Range&>().end()) end() const
+	{
+		return range.end();
+	}
+	template<typename R = Range>
+	decltype(std::declval<const R&>().size()) size() const
+	{
+		return empty ? 0 : range.size();
+	}
+	static_range_partitioner_impl split()
+	{
+		if (empty || !range.is_divisible()) {
+			static_range_partitioner_impl out(range);
+			out.empty = true;
+			return out;
+		}
+		return static_range_partitioner_impl(range.split());
+	}
+};
+
+template<typename Range>
+class auto_range_partitioner_impl {
+	Range range;
+	bool empty;
+	std::size_t num_threads;
+	std::thread::id last_thread;
+
+public:
+	// thread_id is initialized to "no thread" and will be set on first split
+	explicit auto_range_partitioner_impl(Range range)
+		: range(std::move(range)), empty(false) {}
+	decltype(std::declval<const Range&>().begin()) begin() const
+	{
+		return empty ? range.end() : range.begin();
+	}
+	decltype(std::declval<const Range&>().end()) end() const
+	{
+		return range.end();
+	}
+	template<typename R = Range>
+	decltype(std::declval<const R&>().size()) size() const
+	{
+		return empty ? 0 : range.size();
+	}
+	auto_range_partitioner_impl split()
+	{
+		auto_range_partitioner_impl out(range);
+		out.empty = true;
+		if (empty || !range.is_divisible())
+			return out;
+
+		// Check if we are in a different thread than we were before
+		std::thread::id current_thread = std::this_thread::get_id();
+		if (current_thread != last_thread)
+			num_threads = hardware_concurrency();
+
+		// If we only have one thread, don't split
+		if (num_threads <= 1)
+			return out;
+
+		// Split the range at its midpoint
+		out.range = range.split();
+		out.empty = false;
 		out.last_thread = current_thread;
 		last_thread = current_thread;
 		out.num_threads = num_threads / 2;
@@ -133,6 +622,85 @@ public:
 
 } // namespace detail
 
+// Splittable range which divides a range into segments of a fixed number of
+// elements, by walking it once up front and recording the iterator at the
+// start of each segment. Splitting only needs to pick a segment boundary, which
+// makes it O(1) even for ranges without random access iterators, such as those
+// of std::list or std::map. Each segment can't be split any further.
+template<typename Iter>
+class segmented_range {
+	std::shared_ptr<const std::vector<Iter>> bounds;
+	std::size_t first, last;
+	std::size_t grain, length;
+
+public:
+	segmented_range(std::shared_ptr<const std::vector<Iter>> bounds, std::size_t first, std::size_t last, std::size_t grain, std::size_t length)
+		: bounds(std::move(bounds)), first(first), last(last), grain(grain), length(length) {}
+
+	Iter begin() const
+	{
+		return (*bounds)[first];
+	}
+	Iter end() const
+	{
+		return (*bounds)[last];
+	}
+
+	// Every segment except the last one of the whole range is full
+	std::size_t size() const
+	{
+		return std::min(last * grain, length) - first * grain;
+	}
+
+	// Splittable range interface
+	bool is_divisible() const
+	{
+		return last - first > 1;
+	}
+	segmented_range split()
+	{
+		std::size_t middle = first + (last - first + 1) / 2;
+		segmented_range out(bounds, middle, last, grain, length);
+		last = middle;
+		return out;
+	}
+};
+
+// Divide a range into segments of the given number of elements. If no segment
+// size is given, one is chosen the same way as the grain size of a partitioner.
+template<typename Range>
+segmented_range<decltype(std::begin(std::declval<Range>()))> segmented(Range&& range, std::size_t grain)
+{
+	typedef decltype(std::begin(range)) iterator;
+	auto bounds = std::make_shared<std::vector<iterator>>();
+	if (grain == 0)
+		grain = 1;
+
+	iterator current = std::begin(range);
+	iterator end = std::end(range);
+	std::size_t count = 0, length = 0;
+	bounds->push_back(current);
+	while (current != end) {
+		++current;
+		++length;
+		if (++count == grain) {
+			bounds->push_back(current);
+			count = 0;
+		}
+	}
+	if (count != 0)
+		bounds->push_back(current);
+
+	std::size_t last = bounds->size() - 1;
+	return {std::move(bounds), 0, last, grain, length};
+}
+template<typename Range>
+segmented_range<decltype(std::begin(std::declval<Range>()))> segmented(Range&& range)
+{
+	std::size_t grain = detail::auto_grain_size(std::distance(std::begin(range), std::end(range)));
+	return async::segmented(std::forward<Range>(range), grain);
+}
+
 // A simple partitioner which splits until a grain size is reached. If a grain
 // size is not specified, one is chosen automatically.
 template<typename Range>
@@ -141,22 +709,115 @@ detail::static_partitioner_impl<decltype(std::begin(std::declval<Range>()))> sta
 	return {std::begin(range), std::end(range), grain};
 }
 template<typename Range>
-detail::static_partitioner_impl<decltype(std::begin(std::declval<Range>()))> static_partitioner(Range&& range)
+typename std::enable_if<!detail::is_splittable_range<typename std::decay<Range>::type>::value, detail::static_partitioner_impl<decltype(std::begin(std::declval<Range>()))>>::type static_partitioner(Range&& range)
 {
-	std::size_t grain = detail::auto_grain_size(std::distance(std::begin(range), std::end(range)));
-	return {std::begin(range), std::end(range), grain};
+	std::size_t length = std::distance(std::begin(range), std::end(range));
+	return {std::begin(range), std::end(range), length, detail::auto_grain_size(length)};
+}
+template<typename Range>
+typename std::enable_if<detail::is_splittable_range<typename std::decay<Range>::type>::value, detail::static_range_partitioner_impl<typename std::decay<Range>::type>>::type static_partitioner(Range&& range)
+{
+	return detail::static_range_partitioner_impl<typename std::decay<Range>::type>(std::forward<Range>(range));
 }
 
 // A more advanced partitioner which initially divides the range into one chunk
 // for each available thread. The range is split further if a chunk gets stolen
 // by a different thread.
 template<typename Range>
-detail::auto_partitioner_impl<decltype(std::begin(std::declval<Range>()))> auto_partitioner(Range&& range)
+typename std::enable_if<!detail::is_splittable_range<typename std::decay<Range>::type>::value, detail::auto_partitioner_impl<decltype(std::begin(std::declval<Range>()))>>::type auto_partitioner(Range&& range)
 {
-	std::size_t grain = detail::auto_grain_size(std::distance(std::begin(range), std::end(range)));
-	return {std::begin(range), std::end(range), grain};
+	std::size_t length = std::distance(std::begin(range), std::end(range));
+	return {std::begin(range), std::end(range), length, detail::auto_grain_size(length)};
+}
+template<typename Range>
+typename std::enable_if<detail::is_splittable_range<typename std::decay<Range>::type>::value, detail::auto_range_partitioner_impl<typename std::decay<Range>::type>>::type auto_partitioner(Range&& range)
+{
+	return detail::auto_range_partitioner_impl<typename std::decay<Range>::type>(std::forward<Range>(range));
 }
 
+// A partitioner which splits lazily, only when an idle thread could take the
+// other half of the range. This creates far fewer tasks than the other
+// partitioners when a thread pool is already busy. If a grain size is not
+// specified, one is chosen automatically.
+template<typename Range>
+detail::lazy_partitioner_impl<decltype(std::begin(std::declval<Range>()))> lazy_partitioner(Range&& range, std::size_t grain)
+{
+	std::size_t length = std::distance(std::begin(range), std::end(range));
+	return {std::begin(range), std::end(range), length, grain ? grain : 1};
+}
+template<typename Range>
+detail::lazy_partitioner_impl<decltype(std::begin(std::declval<Range>()))> lazy_partitioner(Range&& range)
+{
+	std::size_t length = std::distance(std::begin(range), std::end(range));
+	return {std::begin(range), std::end(range), length, detail::auto_grain_size(length)};
+}
+
+// Grain size estimate which can be kept between calls to adaptive_partitioner,
+// for example in a static variable at the call site, so that later loops start
+// with the grain size learned by earlier ones.
+class grain_tuner {
+	std::shared_ptr<detail::grain_estimate> estimate;
+
+	template<typename Range>
+	friend detail::adaptive_partitioner_impl<decltype(std::begin(std::declval<Range>()))> adaptive_partitioner(Range&& range, grain_tuner& tuner);
+
+public:
+	grain_tuner()
+		: estimate(std::make_shared<detail::grain_estimate>()) {}
+
+	// Measured time per element in nanoseconds, 0 if nothing was measured yet
+	double ns_per_element() const
+	{
+		return estimate->ns_per_element.load(std::memory_order_relaxed);
+	}
+};
+
+// A partitioner which picks its grain size by timing the loop body, so that
+// each leaf runs for long enough to amortize the cost of splitting. A
+// grain_tuner can be passed to reuse the measurements across calls.
+template<typename Range>
+detail::adaptive_partitioner_impl<decltype(std::begin(std::declval<Range>()))> adaptive_partitioner(Range&& range, grain_tuner& tuner)
+{
+	// Never use fewer than a few leaves for each thread
+	std::size_t length = std::distance(std::begin(range), std::end(range));
+	std::size_t max_grain = length / (4 * hardware_concurrency());
+	if (max_grain < 1)
+		max_grain = 1;
+	return {std::begin(range), std::end(range), length, max_grain, tuner.estimate};
+}
+template<typename Range>
+detail::adaptive_partitioner_impl<decltype(std::begin(std::declval<Range>()))> adaptive_partitioner(Range&& range)
+{
+	grain_tuner tuner;
+	return async::adaptive_partitioner(std::forward<Range>(range), tuner);
+}
+
+// Partitioner for loops which are run repeatedly over the same data. The
+// object must be kept alive between loops and applied to each range. It
+// remembers which thread of the thread pool ran each part of the range and
+// sends that part back to the same thread the next time, so that the thread
+// finds the data still in its cache. This only has an effect if the loop is
+// run on the same thread pool.
+class affinity_partitioner {
+	detail::affinity_map map;
+
+public:
+	explicit affinity_partitioner(threadpool_scheduler& sched = default_threadpool_scheduler())
+		: map(sched) {}
+
+	affinity_partitioner(const affinity_partitioner&) = delete;
+	affinity_partitioner& operator=(const affinity_partitioner&) = delete;
+
+	template<typename Range>
+	detail::affinity_partitioner_impl<decltype(std::begin(std::declval<Range>()))> operator()(Range&& range)
+	{
+		std::size_t length = std::distance(std::begin(range), std::end(range));
+		if (length != map.length)
+			map.reset(length);
+		return {std::begin(range), std::end(range), length, 1, &map};
+	}
+};
+
 // Wrap a range in a partitioner. If the input is already a partitioner then it
 // is returned unchanged. This allows parallel algorithms to accept both ranges
 // and partitioners as parameters.
@@ -166,7 +827,12 @@ typename std::enable_if<detail::is_partitioner<typename std::decay<Partitioner>:
 	return std::forward<Partitioner>(partitioner);
 }
 template<typename Range>
-typename std::enable_if<!detail::is_partitioner<typename std::decay<Range>::type>::value, detail::auto_partitioner_impl<decltype(std::begin(std::declval<Range>()))>>::type to_partitioner(Range&& range)
+typename std::enable_if<!detail::is_partitioner<typename std::decay<Range>::type>::value && !detail::is_splittable_range<typename std::decay<Range>::type>::value, detail::auto_partitioner_impl<decltype(std::begin(std::declval<Range>()))>>::type to_partitioner(Range&& range)
+{
+	return async::auto_partitioner(std::forward<Range>(range));
+}
+template<typename Range>
+typename std::enable_if<detail::is_splittable_range<typename std::decay<Range>::type>::value, detail::auto_range_partitioner_impl<typename std::decay<Range>::type>>::type to_partitioner(Range&& range)
 {
 	return async::auto_partitioner(std::forward<Range>(range));
 }
@@ -188,6 +854,16 @@ detail::auto_partitioner_impl<decltype(std::declval<std::initializer_list<T>>().
 	return async::auto_partitioner(async::make_range(range.begin(), range.end()));
 }
 template<typename T>
+detail::lazy_partitioner_impl<decltype(std::declval<std::initializer_list<T>>().begin())> lazy_partitioner(std::initializer_list<T> range)
+{
+	return async::lazy_partitioner(async::make_range(range.begin(), range.end()));
+}
+template<typename T>
+detail::lazy_partitioner_impl<decltype(std::declval<std::initializer_list<T>>().begin())> lazy_partitioner(std::initializer_list<T> range, std::size_t grain)
+{
+	return async::lazy_partitioner(async::make_range(range.begin(), range.end()), grain);
+}
+template<typename T>
 detail::auto_partitioner_impl<decltype(std::declval<std::initializer_list<T>>().begin())> to_partitioner(std::initializer_list<T> range)
 {
 	return async::auto_partitioner(async::make_range(range.begin(), range.end()));
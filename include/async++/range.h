@@ -172,6 +172,167 @@ public:
 	}
 };
 
+// A range of integers with a step between them. The step may be negative, in
+// which case the range counts down from begin to end. The end is excluded and
+// does not need to be a multiple of the step away from begin. This is a
+// separate type from int_range so that unit-stride loops keep their simpler
+// iterator, which only holds the current value.
+template<typename T>
+class strided_int_range {
+	static_assert(std::is_integral<T>::value, "strided_int_range can only be used with integral types");
+
+	// Arithmetic is done on unsigned values so that stepping over the end of
+	// the range can't overflow.
+	typedef typename std::make_unsigned<T>::type unsigned_type;
+
+	T value_begin;
+	std::ptrdiff_t value_step;
+	std::ptrdiff_t length;
+
+public:
+	class iterator {
+		T first;
+		std::ptrdiff_t step;
+		std::ptrdiff_t index;
+
+		iterator(T first, std::ptrdiff_t step, std::ptrdiff_t index)
+			: first(first), step(step), index(index) {}
+		friend class strided_int_range<T>;
+
+		T value(std::ptrdiff_t i) const
+		{
+			return static_cast<T>(static_cast<std::uintmax_t>(static_cast<unsigned_type>(first)) + static_cast<std::uintmax_t>(i) * static_cast<std::uintmax_t>(step));
+		}
+
+	public:
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef iterator pointer;
+		typedef T reference;
+		typedef std::random_access_iterator_tag iterator_category;
+
+		iterator() = default;
+
+		T operator*() const
+		{
+			return value(index);
+		}
+		T operator[](difference_type offset) const
+		{
+			return value(index + offset);
+		}
+
+		iterator& operator++()
+		{
+			++index;
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			return iterator(first, step, index++);
+		}
+		iterator& operator--()
+		{
+			--index;
+			return *this;
+		}
+		iterator operator--(int)
+		{
+			return iterator(first, step, index--);
+		}
+
+		iterator& operator+=(difference_type offset)
+		{
+			index += offset;
+			return *this;
+		}
+		iterator& operator-=(difference_type offset)
+		{
+			index -= offset;
+			return *this;
+		}
+
+		iterator operator+(difference_type offset) const
+		{
+			return iterator(first, step, index + offset);
+		}
+		iterator operator-(difference_type offset) const
+		{
+			return iterator(first, step, index - offset);
+		}
+
+		friend iterator operator+(difference_type offset, iterator other)
+		{
+			return other + offset;
+		}
+
+		friend difference_type operator-(iterator a, iterator b)
+		{
+			return a.index - b.index;
+		}
+
+		friend bool operator==(iterator a, iterator b)
+		{
+			return a.index == b.index;
+		}
+		friend bool operator!=(iterator a, iterator b)
+		{
+			return a.index != b.index;
+		}
+		friend bool operator>(iterator a, iterator b)
+		{
+			return a.index > b.index;
+		}
+		friend bool operator<(iterator a, iterator b)
+		{
+			return a.index < b.index;
+		}
+		friend bool operator>=(iterator a, iterator b)
+		{
+			return a.index >= b.index;
+		}
+		friend bool operator<=(iterator a, iterator b)
+		{
+			return a.index <= b.index;
+		}
+	};
+
+	strided_int_range(T begin, T end, std::ptrdiff_t step)
+		: value_begin(begin), value_step(step), length(0)
+	{
+		LIBASYNC_ASSERT(step != 0, std::invalid_argument, "strided_int_range step must not be zero");
+		unsigned_type distance;
+		std::uintmax_t abs_step;
+		if (step > 0) {
+			if (!(begin < end))
+				return;
+			distance = static_cast<unsigned_type>(static_cast<unsigned_type>(end) - static_cast<unsigned_type>(begin));
+			abs_step = static_cast<std::uintmax_t>(step);
+		} else {
+			if (!(end < begin))
+				return;
+			distance = static_cast<unsigned_type>(static_cast<unsigned_type>(begin) - static_cast<unsigned_type>(end));
+			abs_step = static_cast<std::uintmax_t>(-(step + 1)) + 1;
+		}
+		length = static_cast<std::ptrdiff_t>(distance / abs_step + (distance % abs_step != 0));
+	}
+
+	iterator begin() const
+	{
+		return iterator(value_begin, value_step, 0);
+	}
+	iterator end() const
+	{
+		return iterator(value_begin, value_step, length);
+	}
+
+	// Step between consecutive values
+	std::ptrdiff_t step() const
+	{
+		return value_step;
+	}
+};
+
 // Construct an int_range between 2 values
 template<typename T, typename U>
 int_range<typename std::common_type<T, U>::type> irange(T begin, U end)
@@ -179,4 +340,504 @@ int_range<typename std::common_type<T, U>::type> irange(T begin, U end)
 	return {begin, end};
 }
 
+// Construct a strided_int_range between 2 values with the given step
+template<typename T, typename U>
+strided_int_range<typename std::common_type<T, U>::type> irange(T begin, U end, std::ptrdiff_t step)
+{
+	return {begin, end, step};
+}
+
+// Iterator over several random access iterators at once, which are all moved
+// in lockstep. Dereferencing it gives a tuple of the references of all the
+// underlying iterators.
+template<typename... Iters>
+class zip_iterator {
+	typedef typename detail::make_index_list<sizeof...(Iters)>::type indices;
+
+	std::tuple<Iters...> iters;
+
+	template<std::size_t... I>
+	std::tuple<typename std::iterator_traits<Iters>::reference...> dereference(detail::index_list<I...>, std::ptrdiff_t offset) const
+	{
+		return std::tuple<typename std::iterator_traits<Iters>::reference...>(std::get<I>(iters)[offset]...);
+	}
+	template<std::size_t... I>
+	void advance(detail::index_list<I...>, std::ptrdiff_t offset)
+	{
+		int expand[] = {0, (std::get<I>(iters) += offset, 0)...};
+		(void)expand;
+	}
+
+public:
+	typedef std::tuple<typename std::iterator_traits<Iters>::value_type...> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef void pointer;
+	typedef std::tuple<typename std::iterator_traits<Iters>::reference...> reference;
+	typedef std::random_access_iterator_tag iterator_category;
+
+	zip_iterator() = default;
+	explicit zip_iterator(Iters... iters)
+		: iters(iters...) {}
+
+	// Underlying iterators
+	const std::tuple<Iters...>& get_iterators() const
+	{
+		return iters;
+	}
+
+	reference operator*() const
+	{
+		return dereference(indices(), 0);
+	}
+	reference operator[](difference_type offset) const
+	{
+		return dereference(indices(), offset);
+	}
+
+	zip_iterator& operator++()
+	{
+		advance(indices(), 1);
+		return *this;
+	}
+	zip_iterator operator++(int)
+	{
+		zip_iterator out = *this;
+		advance(indices(), 1);
+		return out;
+	}
+	zip_iterator& operator--()
+	{
+		advance(indices(), -1);
+		return *this;
+	}
+	zip_iterator operator--(int)
+	{
+		zip_iterator out = *this;
+		advance(indices(), -1);
+		return out;
+	}
+
+	zip_iterator& operator+=(difference_type offset)
+	{
+		advance(indices(), offset);
+		return *this;
+	}
+	zip_iterator& operator-=(difference_type offset)
+	{
+		advance(indices(), -offset);
+		return *this;
+	}
+
+	zip_iterator operator+(difference_type offset) const
+	{
+		zip_iterator out = *this;
+		return out += offset;
+	}
+	zip_iterator operator-(difference_type offset) const
+	{
+		zip_iterator out = *this;
+		return out -= offset;
+	}
+
+	friend zip_iterator operator+(difference_type offset, const zip_iterator& other)
+	{
+		return other + offset;
+	}
+
+	// All iterators move together, so only the first one needs to be compared
+	friend difference_type operator-(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) - std::get<0>(b.iters);
+	}
+
+	friend bool operator==(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) == std::get<0>(b.iters);
+	}
+	friend bool operator!=(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) != std::get<0>(b.iters);
+	}
+	friend bool operator>(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) > std::get<0>(b.iters);
+	}
+	friend bool operator<(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) < std::get<0>(b.iters);
+	}
+	friend bool operator>=(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) >= std::get<0>(b.iters);
+	}
+	friend bool operator<=(const zip_iterator& a, const zip_iterator& b)
+	{
+		return std::get<0>(a.iters) <= std::get<0>(b.iters);
+	}
+};
+
+// Range over several ranges at once, yielding tuples of their elements. Since
+// its iterators are random access, partitioners split all the ranges in
+// lockstep.
+template<typename... Iters>
+using zip_range = range<zip_iterator<Iters...>>;
+
+// Zip several ranges of random access iterators together. The result has the
+// length of the first range, which the others must be at least as long as.
+template<typename Range, typename... Ranges>
+zip_range<decltype(std::begin(std::declval<Range>())), decltype(std::begin(std::declval<Ranges>()))...> zip(Range&& range, Ranges&&... ranges)
+{
+	typedef zip_iterator<decltype(std::begin(std::declval<Range>())), decltype(std::begin(std::declval<Ranges>()))...> iterator;
+	auto length = std::end(range) - std::begin(range);
+	return {iterator(std::begin(range), std::begin(ranges)...), iterator(std::begin(range) + length, std::begin(ranges) + length...)};
+}
+
+// Range yielding tuples of the index and the element for each element of a
+// random access range
+template<typename Iter>
+using enumerate_range = zip_range<typename int_range<std::size_t>::iterator, Iter>;
+
+template<typename Range>
+enumerate_range<decltype(std::begin(std::declval<Range>()))> enumerate(Range&& range)
+{
+	std::size_t length = std::end(range) - std::begin(range);
+	return async::zip(async::irange(std::size_t(0), length), std::forward<Range>(range));
+}
+
+// Iterator over the cartesian product of several random access ranges, in
+// row-major order. It moves over the flattened index space, so splitting a
+// range of these iterators divides the whole product evenly regardless of the
+// extent of each dimension. Dereferencing it gives a tuple of the elements at
+// the current position in each dimension.
+template<typename... Iters>
+class collapse_iterator {
+	typedef typename detail::make_index_list<sizeof...(Iters)>::type indices;
+	static const std::size_t dims = sizeof...(Iters);
+
+	std::tuple<Iters...> firsts;
+	std::array<std::ptrdiff_t, sizeof...(Iters)> extents;
+	std::array<std::ptrdiff_t, sizeof...(Iters)> position;
+	std::ptrdiff_t index;
+
+	template<std::size_t... I>
+	std::tuple<typename std::iterator_traits<Iters>::reference...> dereference(detail::index_list<I...>, const std::array<std::ptrdiff_t, sizeof...(Iters)>& pos) const
+	{
+		return std::tuple<typename std::iterator_traits<Iters>::reference...>(std::get<I>(firsts)[pos[I]]...);
+	}
+
+	// Compute the position in each dimension from a flattened index
+	void decode(std::ptrdiff_t flat, std::array<std::ptrdiff_t, sizeof...(Iters)>& pos) const
+	{
+		for (std::size_t i = dims - 1; i != 0; i--) {
+			if (extents[i] == 0)
+				pos[i] = 0;
+			else {
+				pos[i] = flat % extents[i];
+				flat /= extents[i];
+			}
+		}
+		pos[0] = flat;
+	}
+
+public:
+	typedef std::tuple<typename std::iterator_traits<Iters>::value_type...> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef void pointer;
+	typedef std::tuple<typename std::iterator_traits<Iters>::reference...> reference;
+	typedef std::random_access_iterator_tag iterator_category;
+
+	collapse_iterator() = default;
+	collapse_iterator(const std::tuple<Iters...>& firsts, const std::array<std::ptrdiff_t, sizeof...(Iters)>& extents, std::ptrdiff_t index)
+		: firsts(firsts), extents(extents), index(index)
+	{
+		decode(index, position);
+	}
+
+	// Position in each dimension
+	const std::array<std::ptrdiff_t, sizeof...(Iters)>& get_position() const
+	{
+		return position;
+	}
+
+	reference operator*() const
+	{
+		return dereference(indices(), position);
+	}
+	reference operator[](difference_type offset) const
+	{
+		std::array<std::ptrdiff_t, sizeof...(Iters)> pos;
+		decode(index + offset, pos);
+		return dereference(indices(), pos);
+	}
+
+	// Stepping carries into the outer dimensions instead of decoding the index
+	collapse_iterator& operator++()
+	{
+		index++;
+		for (std::size_t i = dims - 1; i != 0; i--) {
+			if (++position[i] < extents[i])
+				return *this;
+			position[i] = 0;
+		}
+		position[0]++;
+		return *this;
+	}
+	collapse_iterator operator++(int)
+	{
+		collapse_iterator out = *this;
+		++*this;
+		return out;
+	}
+	collapse_iterator& operator--()
+	{
+		index--;
+		for (std::size_t i = dims - 1; i != 0; i--) {
+			if (position[i]-- > 0)
+				return *this;
+			position[i] = extents[i] - 1;
+		}
+		position[0]--;
+		return *this;
+	}
+	collapse_iterator operator--(int)
+	{
+		collapse_iterator out = *this;
+		--*this;
+		return out;
+	}
+
+	collapse_iterator& operator+=(difference_type offset)
+	{
+		index += offset;
+		decode(index, position);
+		return *this;
+	}
+	collapse_iterator& operator-=(difference_type offset)
+	{
+		return *this += -offset;
+	}
+
+	collapse_iterator operator+(difference_type offset) const
+	{
+		collapse_iterator out = *this;
+		return out += offset;
+	}
+	collapse_iterator operator-(difference_type offset) const
+	{
+		collapse_iterator out = *this;
+		return out -= offset;
+	}
+
+	friend collapse_iterator operator+(difference_type offset, const collapse_iterator& other)
+	{
+		return other + offset;
+	}
+
+	friend difference_type operator-(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index - b.index;
+	}
+
+	friend bool operator==(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index == b.index;
+	}
+	friend bool operator!=(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index != b.index;
+	}
+	friend bool operator>(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index > b.index;
+	}
+	friend bool operator<(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index < b.index;
+	}
+	friend bool operator>=(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index >= b.index;
+	}
+	friend bool operator<=(const collapse_iterator& a, const collapse_iterator& b)
+	{
+		return a.index <= b.index;
+	}
+};
+
+// Range over the cartesian product of several ranges, for running a loop nest
+// as a single flat loop
+template<typename... Iters>
+using collapse_range = range<collapse_iterator<Iters...>>;
+
+// Collapse a loop nest over several random access ranges into a single range.
+// The first range is the outermost loop.
+template<typename... Ranges>
+collapse_range<decltype(std::begin(std::declval<Ranges>()))...> collapse(Ranges&&... ranges)
+{
+	typedef collapse_iterator<decltype(std::begin(std::declval<Ranges>()))...> iterator;
+	std::array<std::ptrdiff_t, sizeof...(Ranges)> extents = {{static_cast<std::ptrdiff_t>(std::end(ranges) - std::begin(ranges))...}};
+	std::ptrdiff_t total = 1;
+	for (std::ptrdiff_t extent: extents)
+		total *= extent;
+	auto firsts = std::make_tuple(std::begin(ranges)...);
+	return {iterator(firsts, extents, 0), iterator(firsts, extents, total)};
+}
+
+// A multi-dimensional range of integers, which is split along its longest
+// dimension until each dimension is within its grain size. This allows loops
+// over matrices and images to be processed in tiles which fit in the cache.
+// Iterating over a range yields the points in it in row-major order, as arrays
+// of coordinates.
+template<typename T, std::size_t Dims>
+class blocked_range {
+	std::array<T, Dims> value_begin, value_end;
+	std::array<std::size_t, Dims> grain;
+
+	static_assert(std::is_integral<T>::value, "blocked_range can only be used with integral types");
+	static_assert(Dims != 0, "blocked_range must have at least one dimension");
+
+	std::size_t extent(std::size_t dim) const
+	{
+		return value_end[dim] > value_begin[dim] ? static_cast<std::size_t>(value_end[dim] - value_begin[dim]) : 0;
+	}
+
+public:
+	typedef std::array<T, Dims> point;
+
+	class iterator {
+		point current, first, last;
+
+		iterator(const point& current, const point& first, const point& last)
+			: current(current), first(first), last(last) {}
+		friend class blocked_range<T, Dims>;
+
+	public:
+		typedef point value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const point* pointer;
+		typedef const point& reference;
+		typedef std::forward_iterator_tag iterator_category;
+
+		iterator() = default;
+
+		const point& operator*() const
+		{
+			return current;
+		}
+		const point* operator->() const
+		{
+			return &current;
+		}
+
+		// Advance the last coordinate, carrying into the ones before it. The
+		// end position has the first coordinate at its upper bound and all
+		// others at their lower bound.
+		iterator& operator++()
+		{
+			std::size_t dim = Dims - 1;
+			while (dim != 0 && ++current[dim] == last[dim]) {
+				current[dim] = first[dim];
+				dim--;
+			}
+			if (dim == 0)
+				++current[0];
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator out = *this;
+			++*this;
+			return out;
+		}
+
+		friend bool operator==(const iterator& a, const iterator& b)
+		{
+			return a.current == b.current;
+		}
+		friend bool operator!=(const iterator& a, const iterator& b)
+		{
+			return a.current != b.current;
+		}
+	};
+
+	blocked_range(const point& begin, const point& end, const std::array<std::size_t, Dims>& grain)
+		: value_begin(begin), value_end(end), grain(grain) {}
+
+	template<std::size_t D = Dims, typename = typename std::enable_if<D == 2>::type>
+	blocked_range(T row_begin, T row_end, T col_begin, T col_end, std::size_t row_grain = 1, std::size_t col_grain = 1)
+		: value_begin{{row_begin, col_begin}}, value_end{{row_end, col_end}}, grain{{row_grain, col_grain}} {}
+
+	template<std::size_t D = Dims, typename = typename std::enable_if<D == 3>::type>
+	blocked_range(T page_begin, T page_end, T row_begin, T row_end, T col_begin, T col_end, std::size_t page_grain = 1, std::size_t row_grain = 1, std::size_t col_grain = 1)
+		: value_begin{{page_begin, row_begin, col_begin}}, value_end{{page_end, row_end, col_end}}, grain{{page_grain, row_grain, col_grain}} {}
+
+	// Bounds of a single dimension
+	T lower(std::size_t dim) const
+	{
+		return value_begin[dim];
+	}
+	T upper(std::size_t dim) const
+	{
+		return value_end[dim];
+	}
+
+	// Number of points in the range
+	std::size_t size() const
+	{
+		std::size_t out = 1;
+		for (std::size_t dim = 0; dim != Dims; dim++)
+			out *= extent(dim);
+		return out;
+	}
+
+	iterator begin() const
+	{
+		for (std::size_t dim = 0; dim != Dims; dim++) {
+			if (extent(dim) == 0)
+				return end();
+		}
+		return iterator(value_begin, value_begin, value_end);
+	}
+	iterator end() const
+	{
+		point last = value_begin;
+		last[0] = value_begin[0] + static_cast<T>(extent(0));
+		return iterator(last, value_begin, value_end);
+	}
+
+	// Splittable range interface, see partitioner.h
+	bool is_divisible() const
+	{
+		for (std::size_t dim = 0; dim != Dims; dim++) {
+			if (extent(dim) > grain[dim])
+				return true;
+		}
+		return false;
+	}
+	blocked_range split()
+	{
+		// Pick the longest dimension which can still be split
+		std::size_t split_dim = 0;
+		std::size_t longest = 0;
+		for (std::size_t dim = 0; dim != Dims; dim++) {
+			if (extent(dim) > grain[dim] && extent(dim) > longest) {
+				split_dim = dim;
+				longest = extent(dim);
+			}
+		}
+
+		blocked_range out = *this;
+		T middle = value_begin[split_dim] + static_cast<T>((longest + 1) / 2);
+		value_end[split_dim] = middle;
+		out.value_begin[split_dim] = middle;
+		return out;
+	}
+};
+
+// 2D and 3D ranges, using (row, column) and (page, row, column) coordinates
+template<typename T>
+using blocked_range2d = blocked_range<T, 2>;
+template<typename T>
+using blocked_range3d = blocked_range<T, 3>;
+
 } // namespace async
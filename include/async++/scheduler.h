@@ -139,9 +139,16 @@ public:
 	// Run the task and release the handle
 	void run()
 	{
+#ifdef LIBASYNC_TASK_STATS
+		std::uint64_t schedule_time = handle->schedule_time;
+		std::uint64_t start_time = detail::task_stats_now();
+#endif
 		// 不采用c++内置的vtable，稍后再去了解
 		// 类似于task func类有自己实现的`run`虚函数
 		handle->vtable->run(handle.get());
+#ifdef LIBASYNC_TASK_STATS
+		detail::record_task_stats(schedule_time, start_time, detail::task_stats_now());
+#endif
 		handle = nullptr; // 类似于reset，释放一个ref count
 	}
 
@@ -154,6 +161,13 @@ public:
 		set_thread_wait_handler(old);
 	}
 
+	// Get the address of the task object, which identifies the task in
+	// instrumentation hooks
+	const void* get_id() const
+	{
+		return handle.get();
+	}
+
 	// Conversion to and from void pointer. This allows the task handle to be
 	// sent through C APIs which don't preserve types.
 	void* to_void_ptr()
@@ -175,6 +189,10 @@ template<typename Sched>
 void schedule_task(Sched& sched, task_ptr t)
 {
 	static_assert(is_scheduler<Sched>::value, "Type is not a valid scheduler");
+#ifdef LIBASYNC_TASK_TIMESTAMPS
+	t->schedule_time = task_stats_now();
+#endif
+	hooks::task_scheduled(t.get());
 	sched.schedule(task_run_handle(std::move(t)));
 }
 
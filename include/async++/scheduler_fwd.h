@@ -92,6 +92,21 @@ LIBASYNC_EXPORT void wait_for_task(task_base* wait_task);
 // Forward-declaration for data used by threadpool_scheduler
 struct threadpool_data;
 
+// Check whether the current thread should share some of its work with other
+// threads, for use by partitioners which only split on demand. This is true if
+// the current thread is not part of a thread pool, or if its thread pool has
+// idle threads or has stolen everything from the current thread's queue.
+LIBASYNC_EXPORT bool work_requested();
+
+// Only one parallel region runs on a thread pool at a time, since the ranks of
+// concurrent regions could take all the threads between them and wait at their
+// barriers for ranks which never start. begin_region() waits for the pool to
+// be free and returns true, or returns false without waiting if the calling
+// thread is part of the pool or of the running region, in which case the
+// region should run on the calling thread alone.
+LIBASYNC_EXPORT bool begin_region(threadpool_scheduler& sched);
+LIBASYNC_EXPORT void end_region(threadpool_scheduler& sched);
+
 } // namespace detail
 
 // Run a task in the current thread as soon as it is scheduled
@@ -154,6 +169,9 @@ public:
 class threadpool_scheduler {
 	std::unique_ptr<detail::threadpool_data> impl;
 
+	friend bool detail::begin_region(threadpool_scheduler& sched);
+	friend void detail::end_region(threadpool_scheduler& sched);
+
 public:
 	LIBASYNC_EXPORT threadpool_scheduler(threadpool_scheduler&& other);
 
@@ -171,6 +189,19 @@ public:
 
 	// Schedule a task to be run in the thread pool
 	LIBASYNC_EXPORT void schedule(task_run_handle t);
+
+	// Schedule a task on the given thread of the pool. The task is put in
+	// that thread's mailbox, which it checks before trying to steal work. Other
+	// threads only take it if they can't find any other work. Invalid indices
+	// fall back to schedule().
+	LIBASYNC_EXPORT void schedule_on(std::size_t thread, task_run_handle t);
+
+	// Get the number of worker threads in the thread pool
+	LIBASYNC_EXPORT std::size_t num_threads() const;
+
+	// Get the index of the calling thread in the thread pool. Returns
+	// std::size_t(-1) if the calling thread is not a worker of this pool.
+	LIBASYNC_EXPORT std::size_t current_thread_index() const;
 };
 
 namespace detail {
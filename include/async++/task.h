@@ -557,6 +557,20 @@ spawn(Func&& f)
 	return async::spawn(::async::default_scheduler(), std::forward<Func>(f));
 }
 
+// Spawn a function with a label for the task profiler
+template<typename Sched, typename Func>
+decltype(async::spawn(std::declval<Sched&>(), std::declval<labeled_func<typename std::decay<Func>::type>>()))
+spawn(Sched& sched, task_label label, Func&& f)
+{
+	return async::spawn(sched, async::labeled(label.name, std::forward<Func>(f)));
+}
+template<typename Func>
+decltype(async::spawn(::async::default_scheduler(), std::declval<labeled_func<typename std::decay<Func>::type>>()))
+spawn(task_label label, Func&& f)
+{
+	return async::spawn(::async::default_scheduler(), async::labeled(label.name, std::forward<Func>(f)));
+}
+
 // Create a completed task containing a value
 template<typename T>
 task<typename std::decay<T>::type> make_task(T&& value)
@@ -82,6 +82,19 @@ struct LIBASYNC_CACHELINE_ALIGN task_base:
 	// Virtual function table used for dynamic dispatch
 	const task_base_vtable* vtable;
 
+#ifdef LIBASYNC_TASK_TIMESTAMPS
+	// Time at which the task was last scheduled
+	std::uint64_t schedule_time;
+#endif
+
+#ifdef LIBASYNC_WORK_SPAN
+	// Work/span region the task was created in, and its span. Before the task
+	// finishes the span is the earliest point at which it can start.
+	work_span_data* ws_region;
+	std::atomic<std::uint64_t> ws_span;
+	std::atomic<std::uint64_t> ws_burdened_span;
+#endif
+
 	// 类自己的new/delete操作符，调用到这里
 	// 对齐到cache line
 	// 有点疑惑，类定义已经申明了cache line对齐了，为啥还要实现特别的new/delete
@@ -98,7 +111,11 @@ struct LIBASYNC_CACHELINE_ALIGN task_base:
 
 	// Initialize task state
 	task_base()
-		: state(task_state::pending) {}
+		: state(task_state::pending)
+#ifdef LIBASYNC_WORK_SPAN
+		, ws_region(nullptr), ws_span(0), ws_burdened_span(0)
+#endif
+		{}
 
 	// Check whether the task is ready and include an acquire barrier if it is
 	bool ready() const
@@ -110,6 +127,11 @@ struct LIBASYNC_CACHELINE_ALIGN task_base:
 	template<typename Sched>
 	void run_continuation(Sched& sched, task_ptr&& cont)
 	{
+#ifdef LIBASYNC_WORK_SPAN
+		// The continuation can't start before this task finished
+		work_span_max(cont->ws_span, ws_span.load(std::memory_order_relaxed));
+		work_span_max(cont->ws_burdened_span, ws_burdened_span.load(std::memory_order_relaxed));
+#endif
 		LIBASYNC_TRY {
 			detail::schedule_task(sched, std::move(cont));
 		} LIBASYNC_CATCH(...) {
@@ -138,8 +160,11 @@ struct LIBASYNC_CACHELINE_ALIGN task_base:
 		if (!is_finished(current_state)) {
 			// Try to add the task to the continuation list. This can fail only
 			// if the task has just finished, in which case we run it directly.
-			if (continuations.try_add(std::move(cont)))
+			const task_base* cont_ptr = cont.get();
+			if (continuations.try_add(std::move(cont))) {
+				hooks::continuation_added(this, cont_ptr);
 				return;
+			}
 		}
 
 		// Otherwise run the continuation directly
@@ -150,6 +175,9 @@ struct LIBASYNC_CACHELINE_ALIGN task_base:
 	// Finish the task after it has been executed and the result set
 	void finish()
 	{
+#ifdef LIBASYNC_WORK_SPAN
+		work_span_task_finished(this);
+#endif
 		state.store(task_state::completed, std::memory_order_release);
 		run_continuations();
 	}
@@ -159,9 +187,18 @@ struct LIBASYNC_CACHELINE_ALIGN task_base:
 	{
 		task_state s = state.load(std::memory_order_acquire);
 		if (!is_finished(s)) {
+#ifdef LIBASYNC_WORK_SPAN
+			work_span_pause();
+#endif
 			wait_for_task(this);
 			s = state.load(std::memory_order_relaxed);
+#ifdef LIBASYNC_WORK_SPAN
+			work_span_resume();
+#endif
 		}
+#ifdef LIBASYNC_WORK_SPAN
+		work_span_join(ws_span.load(std::memory_order_relaxed), ws_burdened_span.load(std::memory_order_relaxed));
+#endif
 		return s;
 	}
 };
@@ -286,6 +323,9 @@ struct task_result: public task_result_holder<Result> {
 	// Cancel a task with the given exception
 	void cancel_base(std::exception_ptr&& except)
 	{
+#ifdef LIBASYNC_WORK_SPAN
+		work_span_task_finished(this);
+#endif
 		set_exception(std::move(except));
 		this->state.store(task_state::canceled, std::memory_order_release);
 		this->run_continuations();
@@ -415,11 +455,24 @@ struct task_func: public task_result<Result>, func_holder<Func> {
 	{
 		this->vtable = &vtable_impl;
 		this->init_func(std::forward<Args>(args)...);
+#ifdef LIBASYNC_WORK_SPAN
+		work_span_task_created(this, !std::is_same<Sched, inline_scheduler_impl>::value);
+#endif
+		hooks::task_created(this);
 	}
 
 	// Run the stored function
 	static void run(task_base* t) LIBASYNC_NOEXCEPT
 	{
+		hooks::task_started(t);
+#ifdef LIBASYNC_TASK_PROFILE
+		std::uint64_t schedule_time = t->schedule_time;
+		task_profile_context profile_saved = task_profile_begin();
+#endif
+#ifdef LIBASYNC_WORK_SPAN
+		// Tasks run inline don't pay the cost of going through a scheduler
+		work_span_context saved = work_span_task_begin(t, !std::is_same<Sched, inline_scheduler_impl>::value);
+#endif
 		LIBASYNC_TRY {
 			// Dispatch to execution function
 			// get_func()一般返回一个对root_exec_func的引用
@@ -428,6 +481,13 @@ struct task_func: public task_result<Result>, func_holder<Func> {
 		} LIBASYNC_CATCH(...) {
 			cancel(t, std::current_exception());
 		}
+#ifdef LIBASYNC_WORK_SPAN
+		work_span_task_end(saved);
+#endif
+#ifdef LIBASYNC_TASK_PROFILE
+		task_profile_end(get_task_profile_entry<typename profiled_func<Func>::type>(), schedule_time, profile_saved);
+#endif
+		hooks::task_finished(t);
 	}
 
 	// Cancel the task
@@ -435,6 +495,7 @@ struct task_func: public task_result<Result>, func_holder<Func> {
 	{
 		// Destroy the function object when canceling since it won't be
 		// used anymore.
+		hooks::task_canceled(t);
 		static_cast<task_func<Sched, Func, Result>*>(t)->destroy_func();
 		static_cast<task_func<Sched, Func, Result>*>(t)->cancel_base(std::move(except));
 	}
@@ -653,5 +714,15 @@ struct continuation_exec_func<Sched, Parent, Result, Func, fake_void, true>: pri
 	Parent parent;
 };
 
+// Profile tasks by the user's function object type
+template<typename Sched, typename Result, typename Func, bool Unwrap>
+struct profiled_func<root_exec_func<Sched, Result, Func, Unwrap>> {
+	typedef Func type;
+};
+template<typename Sched, typename Parent, typename Result, typename Func, typename ValueCont, bool Unwrap>
+struct profiled_func<continuation_exec_func<Sched, Parent, Result, Func, ValueCont, Unwrap>> {
+	typedef Func type;
+};
+
 } // namespace detail
 } // namespace async
@@ -0,0 +1,198 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+namespace async {
+
+// Label attached to a task type, see labeled()
+struct task_label {
+	const char* name;
+};
+
+// Function object wrapper which gives a name to the type of task it runs in
+// the task profile
+template<typename Func>
+struct labeled_func;
+
+// Per-type task profile entry. The runtime sums the number of runs, run time
+// and queueing delay of all tasks with the same function object type. The run
+// time of a task doesn't include other tasks run by its thread while it waits
+// for them, but does include time spent sleeping in such a wait.
+struct task_profile_record {
+	// Label of the task type, or the name of its function object type
+	std::string name;
+
+	// Name of the function object type
+	std::string type_name;
+
+	// Number of times a task of this type was run
+	std::uint64_t count;
+
+	// Total and longest time spent running, in nanoseconds
+	std::uint64_t run_time;
+	std::uint64_t max_run_time;
+
+	// Total time between tasks being scheduled and starting to run
+	std::uint64_t queue_delay;
+};
+
+// Check whether tasks are being profiled, which requires the library to be
+// built with LIBASYNC_TASK_PROFILE defined (the USE_TASK_PROFILE CMake option)
+LIBASYNC_EXPORT bool task_profile_enabled() LIBASYNC_NOEXCEPT;
+
+// Get the profile of every task type which has run at least once, sorted by
+// total run time. Different types can have the same name, for example lambdas
+// in the same function, in which case labeled() can tell them apart. A type
+// used in several modules (shared libraries) gets a separate entry in each.
+LIBASYNC_EXPORT std::vector<task_profile_record> get_task_profile();
+
+// Clear all profile counters
+LIBASYNC_EXPORT void reset_task_profile();
+
+// Format a profile as a text table with one row per task type
+LIBASYNC_EXPORT std::string task_profile_to_table(const std::vector<task_profile_record>& profile);
+
+namespace detail {
+
+#ifdef LIBASYNC_TASK_PROFILE
+struct task_profile_entry;
+LIBASYNC_EXPORT void register_task_profile_entry(task_profile_entry* entry);
+LIBASYNC_EXPORT void unregister_task_profile_entry(task_profile_entry* entry) LIBASYNC_NOEXCEPT;
+
+// Profile entry for one task type. The counters are kept separately by each
+// thread and are only summed when the profile is exported, so recording a task
+// never writes to memory shared with other threads. Entries register themselves
+// in a global list when they are created, which gives them their index in the
+// per-thread counters, and remove themselves when they are destroyed.
+struct task_profile_entry {
+	const char* type_name;
+	std::atomic<const char*> label;
+	std::size_t index;
+
+	// Links in the global list, protected by its lock
+	task_profile_entry* prev;
+	task_profile_entry* next;
+
+	explicit task_profile_entry(const char* type_name_)
+		: type_name(type_name_), label(nullptr), index(0)
+	{
+		register_task_profile_entry(this);
+	}
+	~task_profile_entry()
+	{
+		unregister_task_profile_entry(this);
+	}
+};
+
+// State of the task interrupted by a task starting to run on the same thread,
+// which happens when a task waits for another one
+struct task_profile_context {
+	std::uint64_t start_time;
+	std::uint64_t nested_time;
+};
+
+// A task starts running, returns the state of the task it interrupted
+LIBASYNC_EXPORT task_profile_context task_profile_begin() LIBASYNC_NOEXCEPT;
+
+// A task finished running. The time spent running other tasks nested in it is
+// not counted as its run time, and is added to the task it interrupted.
+LIBASYNC_EXPORT void task_profile_end(const task_profile_entry& entry, std::uint64_t schedule_time, const task_profile_context& saved) LIBASYNC_NOEXCEPT;
+
+// Name of a type as given by the compiler's function signature macro. The
+// type is extracted from the signature when the profile is exported.
+template<typename T>
+const char* task_type_name()
+{
+#if defined(__GNUC__)
+	return __PRETTY_FUNCTION__;
+#elif defined(_MSC_VER)
+	return __FUNCSIG__;
+#else
+	return "unknown";
+#endif
+}
+
+// Profile entry for a function object type
+template<typename Func>
+task_profile_entry& get_task_profile_entry()
+{
+	static task_profile_entry entry(task_type_name<Func>());
+	return entry;
+}
+#endif
+
+// Function object type which is profiled for a task function. Task functions
+// wrap the user's function object, this is specialized to unwrap them.
+template<typename Func>
+struct profiled_func {
+	typedef Func type;
+};
+
+} // namespace detail
+
+template<typename Func>
+struct labeled_func {
+	Func func;
+
+	template<typename F>
+	labeled_func(const char* name, F&& f)
+		: func(std::forward<F>(f))
+	{
+#ifdef LIBASYNC_TASK_PROFILE
+		detail::get_task_profile_entry<labeled_func>().label.store(name, std::memory_order_relaxed);
+#else
+		(void)name;
+#endif
+	}
+
+	template<typename... Args>
+	auto operator()(Args&&... args) -> decltype(std::declval<Func&>()(std::forward<Args>(args)...))
+	{
+		return func(std::forward<Args>(args)...);
+	}
+	template<typename... Args>
+	auto operator()(Args&&... args) const -> decltype(std::declval<const Func&>()(std::forward<Args>(args)...))
+	{
+		return func(std::forward<Args>(args)...);
+	}
+};
+
+// Give a name to the tasks running a function object in the task profile,
+// for use with spawn() or then(). Since tasks are profiled by function object
+// type, the label applies to all tasks of that type and the last label given
+// is used. The name must be a string literal or otherwise outlive the program.
+template<typename Func>
+labeled_func<typename std::decay<Func>::type> labeled(const char* name, Func&& f)
+{
+	return {name, std::forward<Func>(f)};
+}
+
+// Label for use with spawn(label, f), which is equivalent to
+// spawn(labeled(name, f))
+inline task_label labeled(const char* name)
+{
+	return {name};
+}
+
+} // namespace async
@@ -0,0 +1,220 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+// Tasks are timestamped when they are scheduled if either task statistics or
+// the task profiler are enabled
+#if defined(LIBASYNC_TASK_STATS) || defined(LIBASYNC_TASK_PROFILE)
+# define LIBASYNC_TASK_TIMESTAMPS
+#endif
+
+namespace async {
+
+// Histogram of durations in nanoseconds. Durations below 128ns are recorded
+// exactly and longer ones with 7 significant bits, which gives 64 buckets per
+// power of two, so percentiles are accurate to about 1.6%.
+class task_stats_histogram {
+public:
+	// Number of significant bits kept from each value
+	static const unsigned precision = 7;
+	static const std::size_t half_bucket_count = std::size_t(1) << (precision - 1);
+	static const std::size_t bucket_count = (64 - precision + 2) * half_bucket_count;
+
+private:
+	std::vector<std::uint64_t> counts;
+	std::uint64_t total;
+	std::uint64_t min_value;
+	std::uint64_t max_value;
+	std::uint64_t sum;
+
+public:
+	task_stats_histogram()
+		: counts(bucket_count), total(0), min_value(0), max_value(0), sum(0) {}
+
+	// Get the bucket a value is recorded in
+	static std::size_t bucket_index(std::uint64_t value)
+	{
+		if (value < (std::uint64_t(1) << precision))
+			return static_cast<std::size_t>(value);
+#ifdef __GNUC__
+		unsigned msb = 63 - __builtin_clzll(value);
+#else
+		unsigned msb = 0;
+		for (std::uint64_t v = value; v >>= 1;)
+			msb++;
+#endif
+		unsigned shift = msb - (precision - 1);
+		return (static_cast<std::size_t>(shift) << (precision - 1)) + static_cast<std::size_t>(value >> shift);
+	}
+
+	// Range of values which are recorded in a bucket
+	static std::uint64_t bucket_lower_bound(std::size_t index)
+	{
+		if (index < (std::size_t(1) << precision))
+			return index;
+		unsigned shift = static_cast<unsigned>(index / half_bucket_count - 1);
+		return static_cast<std::uint64_t>(index % half_bucket_count + half_bucket_count) << shift;
+	}
+	static std::uint64_t bucket_upper_bound(std::size_t index)
+	{
+		if (index < (std::size_t(1) << precision))
+			return index;
+		unsigned shift = static_cast<unsigned>(index / half_bucket_count - 1);
+		return ((static_cast<std::uint64_t>(index % half_bucket_count + half_bucket_count) + 1) << shift) - 1;
+	}
+
+	void record(std::uint64_t value)
+	{
+		add(bucket_index(value), 1, value, value, value);
+	}
+
+	// Add a number of values to a bucket, along with their minimum, maximum and
+	// sum, used to build a histogram from another representation
+	void add(std::size_t index, std::uint64_t count, std::uint64_t min, std::uint64_t max, std::uint64_t values_sum)
+	{
+		if (count == 0)
+			return;
+		if (total == 0 || min < min_value)
+			min_value = min;
+		if (max > max_value)
+			max_value = max;
+		counts[index] += count;
+		total += count;
+		sum += values_sum;
+	}
+
+	void merge(const task_stats_histogram& other)
+	{
+		if (other.total == 0)
+			return;
+		for (std::size_t i = 0; i < bucket_count; i++)
+			counts[i] += other.counts[i];
+		if (total == 0 || other.min_value < min_value)
+			min_value = other.min_value;
+		if (other.max_value > max_value)
+			max_value = other.max_value;
+		total += other.total;
+		sum += other.sum;
+	}
+
+	// Number of values in a bucket
+	std::uint64_t bucket(std::size_t index) const
+	{
+		return counts[index];
+	}
+
+	std::uint64_t count() const
+	{
+		return total;
+	}
+	std::uint64_t min() const
+	{
+		return min_value;
+	}
+	std::uint64_t max() const
+	{
+		return max_value;
+	}
+	double mean() const
+	{
+		return total ? static_cast<double>(sum) / static_cast<double>(total) : 0;
+	}
+
+	// Value below which the given percentage of the recorded values lie,
+	// rounded up to the end of its bucket
+	std::uint64_t percentile(double p) const
+	{
+		if (total == 0)
+			return 0;
+		std::uint64_t rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(total) + 0.5);
+		if (rank == 0)
+			rank = 1;
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < bucket_count; i++) {
+			seen += counts[i];
+			if (seen >= rank)
+				return std::min(bucket_upper_bound(i), max_value);
+		}
+		return max_value;
+	}
+};
+
+// Task timing statistics. These are only recorded if the library was built
+// with LIBASYNC_TASK_STATS defined (the USE_TASK_STATS CMake option). The time
+// a task spends running includes any tasks run by its thread while it waits
+// for another task.
+//
+// Recording costs three clock reads and a few uncontended stores per task,
+// about 180ns per task when steady_clock::now() takes 45ns. Without
+// LIBASYNC_TASK_STATS there is no cost at all.
+struct task_stats {
+	// Time between a task being scheduled and starting to run
+	task_stats_histogram queue_delay;
+
+	// Time taken to run a task
+	task_stats_histogram run_time;
+
+	void merge(const task_stats& other)
+	{
+		queue_delay.merge(other.queue_delay);
+		run_time.merge(other.run_time);
+	}
+};
+
+// Check whether task statistics are being recorded
+LIBASYNC_EXPORT bool task_stats_enabled() LIBASYNC_NOEXCEPT;
+
+// Get the statistics recorded by each thread which has run tasks. Threads which
+// have exited are included, their slots are reused by new threads.
+LIBASYNC_EXPORT std::vector<task_stats> get_thread_task_stats();
+
+// Get the statistics of all threads merged together
+LIBASYNC_EXPORT task_stats get_task_stats();
+
+// Clear all recorded statistics. Tasks which finish while this is running may
+// or may not be counted.
+LIBASYNC_EXPORT void reset_task_stats();
+
+// Format statistics as a JSON object with the count, mean, min, max and common
+// percentiles of each histogram, followed by its non-empty buckets
+LIBASYNC_EXPORT std::string task_stats_to_json(const task_stats& stats);
+
+namespace detail {
+
+#ifdef LIBASYNC_TASK_TIMESTAMPS
+// Timestamp used by task statistics and the task profiler
+inline std::uint64_t task_stats_now() LIBASYNC_NOEXCEPT
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif
+
+#ifdef LIBASYNC_TASK_STATS
+
+// Record the timestamps of a task run in the current thread's histograms
+LIBASYNC_EXPORT void record_task_stats(std::uint64_t schedule_time, std::uint64_t start_time, std::uint64_t end_time) LIBASYNC_NOEXCEPT;
+#endif
+
+} // namespace detail
+} // namespace async
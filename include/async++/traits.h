@@ -45,6 +45,16 @@ T fake_void_to_void(T&& x)
 }
 inline void fake_void_to_void(fake_void) {}
 
+// Compile-time list of indices 0...N-1, used to expand tuples
+template<std::size_t... Indices>
+struct index_list {};
+template<std::size_t N, std::size_t... Indices>
+struct make_index_list: public make_index_list<N - 1, N - 1, Indices...> {};
+template<std::size_t... Indices>
+struct make_index_list<0, Indices...> {
+	typedef index_list<Indices...> type;
+};
+
 // Check if type is a task type, used to detect task unwraping
 template<typename T>
 struct is_task: public std::false_type {};
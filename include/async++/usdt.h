@@ -0,0 +1,116 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+// Static tracing probes in the SystemTap SDT format, which perf, bpftrace and
+// SystemTap can attach to without recompiling. Each probe is a single nop
+// instruction plus an ELF note describing where its arguments are, so there
+// is no runtime dependency and no cost beyond the nop when nothing is
+// attached. Probes are enabled with LIBASYNC_USDT_PROBES (the USE_USDT_PROBES
+// CMake option) and are only supported on 64-bit ELF targets. All probes
+// belong to the "asyncpp" provider, see tools/bpftrace for examples.
+#if defined(LIBASYNC_USDT_PROBES) && defined(__GNUC__) && defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+# define LIBASYNC_HAVE_USDT_PROBES
+
+// Same layout as the notes emitted by <sys/sdt.h>, without semaphores
+# define LIBASYNC_USDT_NOTE(name, args) \
+	"990: nop\n" \
+	".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+	".balign 4\n" \
+	".4byte 992f-991f, 994f-993f, 3\n" \
+	"991: .asciz \"stapsdt\"\n" \
+	"992: .balign 4\n" \
+	"993: .8byte 990b\n" \
+	".8byte _.stapsdt.base\n" \
+	".8byte 0\n" \
+	".asciz \"asyncpp\"\n" \
+	".asciz \"" #name "\"\n" \
+	".asciz \"" args "\"\n" \
+	"994: .balign 4\n" \
+	".popsection\n" \
+	".ifndef _.stapsdt.base\n" \
+	".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+	".weak _.stapsdt.base\n" \
+	".hidden _.stapsdt.base\n" \
+	"_.stapsdt.base: .space 1\n" \
+	".size _.stapsdt.base, 1\n" \
+	".popsection\n" \
+	".endif\n"
+
+// Probes with 1 to 3 unsigned 64-bit arguments
+# define LIBASYNC_USDT1(name, x0) \
+	__asm__ __volatile__(LIBASYNC_USDT_NOTE(name, "8@%[a0]") \
+	                     :: [a0] "r" (static_cast<std::uint64_t>(x0)))
+# define LIBASYNC_USDT2(name, x0, x1) \
+	__asm__ __volatile__(LIBASYNC_USDT_NOTE(name, "8@%[a0] 8@%[a1]") \
+	                     :: [a0] "r" (static_cast<std::uint64_t>(x0)), [a1] "r" (static_cast<std::uint64_t>(x1)))
+# define LIBASYNC_USDT3(name, x0, x1, x2) \
+	__asm__ __volatile__(LIBASYNC_USDT_NOTE(name, "8@%[a0] 8@%[a1] 8@%[a2]") \
+	                     :: [a0] "r" (static_cast<std::uint64_t>(x0)), [a1] "r" (static_cast<std::uint64_t>(x1)), [a2] "r" (static_cast<std::uint64_t>(x2)))
+
+namespace async {
+
+// Hooks which fire a probe at each hook point. Tasks are passed as their
+// address and threads as their index in the thread pool.
+struct usdt_hooks {
+	static void task_created(const void* task)
+	{
+		LIBASYNC_USDT1(task_created, reinterpret_cast<std::uintptr_t>(task));
+	}
+	static void task_scheduled(const void* task)
+	{
+		LIBASYNC_USDT1(task_scheduled, reinterpret_cast<std::uintptr_t>(task));
+	}
+	static void task_started(const void* task)
+	{
+		LIBASYNC_USDT1(task_start, reinterpret_cast<std::uintptr_t>(task));
+	}
+	static void task_finished(const void* task)
+	{
+		LIBASYNC_USDT1(task_end, reinterpret_cast<std::uintptr_t>(task));
+	}
+	static void task_canceled(const void* task)
+	{
+		LIBASYNC_USDT1(task_canceled, reinterpret_cast<std::uintptr_t>(task));
+	}
+	static void task_stolen(const void* task, std::size_t thief, std::size_t victim)
+	{
+		LIBASYNC_USDT3(task_stolen, reinterpret_cast<std::uintptr_t>(task), thief, victim);
+	}
+	static void worker_park(std::size_t thread)
+	{
+		LIBASYNC_USDT1(worker_park, thread);
+	}
+	static void worker_unpark(std::size_t thread)
+	{
+		LIBASYNC_USDT1(worker_unpark, thread);
+	}
+	static void continuation_added(const void* parent, const void* continuation)
+	{
+		LIBASYNC_USDT2(continuation_added, reinterpret_cast<std::uintptr_t>(parent), reinterpret_cast<std::uintptr_t>(continuation));
+	}
+};
+
+} // namespace async
+#endif
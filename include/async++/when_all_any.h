@@ -42,12 +42,34 @@ struct when_all_state: public ref_count_base<when_all_state<Result>> {
 	event_task<Result> event;
 	Result result;
 
+#ifdef LIBASYNC_WORK_SPAN
+	// Longest span of the tasks finished so far
+	std::atomic<std::uint64_t> span;
+	std::atomic<std::uint64_t> burdened_span;
+
+	when_all_state(std::size_t count)
+		: ref_count_base<when_all_state<Result>>(count), span(0), burdened_span(0) {}
+
+	// Record the span of a finished task
+	void join(const task_base* t)
+	{
+		work_span_max(span, t->ws_span.load(std::memory_order_relaxed));
+		work_span_max(burdened_span, t->ws_burdened_span.load(std::memory_order_relaxed));
+	}
+#else
 	when_all_state(std::size_t count)
 		: ref_count_base<when_all_state<Result>>(count) {}
+#endif
 
 	// When all references are dropped, signal the event
 	~when_all_state()
 	{
+#ifdef LIBASYNC_WORK_SPAN
+		// The event depends on all of the tasks, not just the last one
+		task_base* t = get_internal_task(event);
+		work_span_max(t->ws_span, span.load(std::memory_order_relaxed));
+		work_span_max(t->ws_burdened_span, burdened_span.load(std::memory_order_relaxed));
+#endif
 		event.set(std::move(result));
 	}
 };
@@ -65,6 +87,9 @@ struct when_all_func_range {
 	// automatically signaled when all references are dropped.
 	void operator()(Task t) const
 	{
+#ifdef LIBASYNC_WORK_SPAN
+		state->join(get_internal_task(t));
+#endif
 		state->result[index] = std::move(t);
 	}
 };
@@ -79,6 +104,9 @@ struct when_all_func_tuple {
 	// automatically signaled when all references are dropped.
 	void operator()(Task t) const
 	{
+#ifdef LIBASYNC_WORK_SPAN
+		state->join(get_internal_task(t));
+#endif
 		std::get<index>(state->result) = std::move(t);
 	}
 };
@@ -137,6 +165,20 @@ void when_all_variadic(when_all_state<Result>* state, First&& first, T&&... task
 	detail::when_all_variadic<index + 1>(state, std::forward<T>(tasks)...);
 }
 
+// Add a copy of each task to the results of when_any because the event may be
+// set before all tasks have finished. This must be done before adding any
+// continuation, since the first task to finish moves the results out.
+template<std::size_t index, typename Result>
+void when_any_copy_variadic(when_any_state<Result>*) {}
+template<std::size_t index, typename Result, typename First, typename... T>
+void when_any_copy_variadic(when_any_state<Result>* state, const First& first, const T&... tasks)
+{
+	detail::task_base* t = detail::get_internal_task(first);
+	t->add_ref();
+	detail::set_internal_task(std::get<index>(state->result), detail::task_ptr(t));
+	detail::when_any_copy_variadic<index + 1>(state, tasks...);
+}
+
 // Internal implementation of when_any for variadic arguments
 template<std::size_t index, typename Result>
 void when_any_variadic(when_any_state<Result>*) {}
@@ -145,12 +187,6 @@ void when_any_variadic(when_any_state<Result>* state, First&& first, T&&... task
 {
 	typedef typename std::decay<First>::type task_type;
 
-	// Add a copy of the task to the results because the event may be
-	// set before all tasks have finished.
-	detail::task_base* t = detail::get_internal_task(first);
-	t->add_ref();
-	detail::set_internal_task(std::get<index>(state->result), detail::task_ptr(t));
-
 	// Add a continuation to the task
 	LIBASYNC_TRY {
 		first.then(inline_scheduler(), detail::when_any_func<task_type, Result>(index, detail::ref_count_ptr<detail::when_any_state<Result>>(state)));
@@ -217,14 +253,18 @@ when_any(Iter begin, Iter end)
 	state->result.resize(count);
 	auto out = state->event.get_task();
 
-	// Add a continuation to each task to set the event. First one wins.
-	for (std::size_t i = 0; begin != end; i++, ++begin) {
-		// Add a copy of the task to the results because the event may be
-		// set before all tasks have finished.
-		detail::task_base* t = detail::get_internal_task(*begin);
+	// Add a copy of each task to the results because the event may be set
+	// before all tasks have finished. This must be done before adding any
+	// continuation, since the first task to finish moves the results out.
+	Iter it = begin;
+	for (std::size_t i = 0; it != end; i++, ++it) {
+		detail::task_base* t = detail::get_internal_task(*it);
 		t->add_ref();
 		detail::set_internal_task(state->result[i], detail::task_ptr(t));
+	}
 
+	// Add a continuation to each task to set the event. First one wins.
+	for (std::size_t i = 0; begin != end; i++, ++begin) {
 		LIBASYNC_TRY {
 			(*begin).then(inline_scheduler(), detail::when_any_func<task_type, result_type>(i, detail::ref_count_ptr<detail::when_any_state<result_type>>(state)));
 		} LIBASYNC_CATCH(...) {
@@ -290,6 +330,7 @@ when_any(T&&... tasks)
 	auto out = state->event.get_task();
 
 	// Register all the tasks on the event
+	detail::when_any_copy_variadic<0>(state, tasks...);
 	detail::when_any_variadic<0>(state, std::forward<T>(tasks)...);
 
 	return out;
@@ -0,0 +1,151 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef ASYNCXX_H_
+# error "Do not include this header directly, include <async++.h> instead."
+#endif
+
+// Work/span analysis in the style of Cilkview. When the library is built with
+// LIBASYNC_WORK_SPAN defined (the USE_WORK_SPAN CMake option), every task
+// created inside a work_span_region measures the time it spends running
+// (work) and the longest chain of dependent work leading to its completion
+// (span). Dependencies are followed through spawn(), local_spawn(), then(),
+// get(), wait() and when_all().
+//
+// Time spent blocked waiting for another task is not counted as work, and a
+// task which runs other tasks while it waits is paused while they run.
+
+namespace async {
+
+// Summary of a work/span region, all times are in nanoseconds
+struct work_span_report {
+	// Name given to the region
+	std::string name;
+
+	// Total time spent running tasks in the region, including the thread
+	// which created the region
+	std::uint64_t work;
+
+	// Length of the critical path through the region
+	std::uint64_t span;
+
+	// Length of the critical path when each task spawned along it pays the
+	// region's spawn burden when it starts
+	std::uint64_t burdened_span;
+
+	// Number of tasks spawned in the region, not counting continuations which
+	// run inline such as those used internally by when_all()
+	std::uint64_t tasks;
+
+	// Average amount of work that can run in parallel. Speedup can't exceed
+	// this no matter how many threads are used.
+	double parallelism() const
+	{
+		return span ? static_cast<double>(work) / static_cast<double>(span) : 0;
+	}
+
+	// Parallelism once scheduling overhead is accounted for. If this is much
+	// lower than parallelism() then tasks are too small.
+	double burdened_parallelism() const
+	{
+		return burdened_span ? static_cast<double>(work) / static_cast<double>(burdened_span) : 0;
+	}
+};
+
+// Check whether work/span analysis is enabled
+LIBASYNC_EXPORT bool work_span_enabled() LIBASYNC_NOEXCEPT;
+
+// Print a report on a single line to stderr
+LIBASYNC_EXPORT void print_work_span_report(const work_span_report& report);
+
+// Region in which tasks are analyzed. The region covers the lifetime of the
+// object on the thread which created it, which should wait for all tasks
+// spawned in the region before it ends. The report is passed to the handler
+// when the region ends. Regions should not be nested, time spent in an inner
+// region is not counted in the outer one.
+class work_span_region {
+	struct internal_data;
+	std::unique_ptr<internal_data> impl;
+
+public:
+	// Default cost charged to the burdened span for each task spawned on the
+	// critical path
+	static const std::uint64_t default_spawn_burden = 1000;
+
+	LIBASYNC_EXPORT explicit work_span_region(std::string name,
+	                                          std::function<void(const work_span_report&)> handler = print_work_span_report,
+	                                          std::uint64_t spawn_burden = default_spawn_burden);
+	LIBASYNC_EXPORT ~work_span_region();
+
+	work_span_region(const work_span_region&) = delete;
+	work_span_region& operator=(const work_span_region&) = delete;
+
+	// Get the current state of the region, with the creating thread's span
+	// measured up to now
+	LIBASYNC_EXPORT work_span_report report() const;
+};
+
+namespace detail {
+
+#ifdef LIBASYNC_WORK_SPAN
+struct task_base;
+struct work_span_data;
+
+// State of the strand of execution running on a thread. A paused strand has a
+// resume time of 0.
+struct work_span_context {
+	work_span_data* region;
+	std::uint64_t span;
+	std::uint64_t burdened_span;
+	std::uint64_t resume_time;
+};
+
+// A task was created by the current strand. Spawned tasks go through a
+// scheduler, unlike continuations run inline.
+LIBASYNC_EXPORT void work_span_task_created(task_base* t, bool spawned) LIBASYNC_NOEXCEPT;
+
+// A task starts running, returns the state of the strand it interrupted.
+// Spawned tasks pay the spawn burden when they start.
+LIBASYNC_EXPORT work_span_context work_span_task_begin(task_base* t, bool spawned) LIBASYNC_NOEXCEPT;
+
+// A task finished running, resume the interrupted strand
+LIBASYNC_EXPORT void work_span_task_end(const work_span_context& saved) LIBASYNC_NOEXCEPT;
+
+// A task completed or was canceled by the current strand
+LIBASYNC_EXPORT void work_span_task_finished(task_base* t) LIBASYNC_NOEXCEPT;
+
+// The current strand blocks and then resumes
+LIBASYNC_EXPORT void work_span_pause() LIBASYNC_NOEXCEPT;
+LIBASYNC_EXPORT void work_span_resume() LIBASYNC_NOEXCEPT;
+
+// The current strand depends on something which completed with this span
+LIBASYNC_EXPORT void work_span_join(std::uint64_t span, std::uint64_t burdened_span) LIBASYNC_NOEXCEPT;
+
+// Raise an atomic span value to at least the given value
+inline void work_span_max(std::atomic<std::uint64_t>& target, std::uint64_t value) LIBASYNC_NOEXCEPT
+{
+	std::uint64_t current = target.load(std::memory_order_relaxed);
+	while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+#endif
+
+} // namespace detail
+} // namespace async
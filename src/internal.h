@@ -45,7 +45,12 @@
 #endif
 
 // We don't make use of dynamic TLS initialization/destruction so we can just
-// use the legacy TLS attributes.
+// use the legacy TLS attributes. The exceptions are the owners of a thread's
+// slot in the task statistics and the task profiler, which need a destructor
+// to hand the slot back when the thread exits and so are C++11 thread_locals.
+// They are only touched the first time a thread records anything, the hot path
+// reads a THREAD_LOCAL pointer to the slot instead. Platforms without
+// thread_local support use the pthread emulation below for both.
 #ifdef __GNUC__
 # define  THREAD_LOCAL __thread
 #elif defined (_MSC_VER)
@@ -0,0 +1,389 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "internal.h"
+
+#include <cstdio>
+
+// for pthread thread_local emulation
+#if defined(LIBASYNC_TASK_PROFILE) && defined(EMULATE_PTHREAD_THREAD_LOCAL)
+# include <pthread.h>
+#endif
+
+namespace async {
+namespace detail {
+
+#ifdef LIBASYNC_TASK_PROFILE
+// Counters of one task type in one thread. They are only written by the thread
+// owning them, with plain loads and stores, and can be read concurrently when
+// the profile is exported.
+struct task_profile_counters {
+	std::atomic<std::uint64_t> count;
+	std::atomic<std::uint64_t> run_time;
+	std::atomic<std::uint64_t> max_run_time;
+	std::atomic<std::uint64_t> queue_delay;
+
+	task_profile_counters()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		count.store(0, std::memory_order_relaxed);
+		run_time.store(0, std::memory_order_relaxed);
+		max_run_time.store(0, std::memory_order_relaxed);
+		queue_delay.store(0, std::memory_order_relaxed);
+	}
+};
+
+// Counters are allocated in blocks as new task types show up. Types beyond the
+// last block are not recorded.
+const std::size_t task_profile_block_size = 64;
+const std::size_t task_profile_max_blocks = 1024;
+
+// Profile data of one thread. Slots are never freed, when a thread exits its
+// slot is released and can be picked up by the next new thread.
+//
+// Resets work as in the task statistics: reset_epoch is bumped and the owner
+// clears its counters before it next records, so that a reset never races
+// with a record. Until then, readers skip the slot.
+struct task_profile_slot {
+	std::atomic<task_profile_counters*> blocks[task_profile_max_blocks];
+
+	// Time spent so far running tasks nested in the running task, only used by
+	// the owning thread
+	std::uint64_t nested_time;
+
+	std::atomic<std::uint64_t> reset_epoch;
+	std::atomic<std::uint64_t> applied_epoch;
+	bool in_use;
+
+	task_profile_slot()
+		: nested_time(0), reset_epoch(0), applied_epoch(0), in_use(true)
+	{
+		for (std::size_t i = 0; i < task_profile_max_blocks; i++)
+			blocks[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	// Clear the counters if a reset is pending, only called by the owner or
+	// with the slots locked when the slot has no owner
+	void apply_reset()
+	{
+		std::uint64_t epoch = reset_epoch.load(std::memory_order_relaxed);
+		if (epoch == applied_epoch.load(std::memory_order_relaxed))
+			return;
+		for (std::size_t i = 0; i < task_profile_max_blocks; i++) {
+			task_profile_counters* block = blocks[i].load(std::memory_order_relaxed);
+			if (!block)
+				continue;
+			for (std::size_t j = 0; j < task_profile_block_size; j++)
+				block[j].reset();
+		}
+		applied_epoch.store(epoch, std::memory_order_release);
+	}
+
+	// Whether the counters are up to date with the last reset
+	bool reset_applied() const
+	{
+		return applied_epoch.load(std::memory_order_acquire) == reset_epoch.load(std::memory_order_relaxed);
+	}
+
+	// Get the counters of a task type, only called by the owning thread
+	task_profile_counters* counters(std::size_t index) LIBASYNC_NOEXCEPT
+	{
+		std::size_t block_index = index / task_profile_block_size;
+		if (block_index >= task_profile_max_blocks)
+			return nullptr;
+		task_profile_counters* block = blocks[block_index].load(std::memory_order_relaxed);
+		if (!block) {
+			block = new (std::nothrow) task_profile_counters[task_profile_block_size];
+			if (!block)
+				return nullptr;
+			blocks[block_index].store(block, std::memory_order_release);
+		}
+		return &block[index % task_profile_block_size];
+	}
+};
+
+// List of all profile entries and of all thread slots. This is deliberately
+// leaked so that entries destroyed by static destructors, and threads which
+// exit after them, can still unregister themselves.
+struct task_profile_registry {
+	std::mutex lock;
+	task_profile_entry* head;
+	std::size_t num_entries;
+
+	std::mutex slots_lock;
+	std::vector<task_profile_slot*> slots;
+
+	task_profile_registry()
+		: head(nullptr), num_entries(0) {}
+};
+static task_profile_registry& get_task_profile_registry()
+{
+	static task_profile_registry* registry = new task_profile_registry;
+	return *registry;
+}
+
+void register_task_profile_entry(task_profile_entry* entry)
+{
+	task_profile_registry& registry = get_task_profile_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	entry->index = registry.num_entries++;
+	entry->prev = nullptr;
+	entry->next = registry.head;
+	if (registry.head)
+		registry.head->prev = entry;
+	registry.head = entry;
+}
+
+void unregister_task_profile_entry(task_profile_entry* entry) LIBASYNC_NOEXCEPT
+{
+	task_profile_registry& registry = get_task_profile_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		registry.head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+}
+
+static task_profile_slot* acquire_task_profile_slot()
+{
+	task_profile_registry& registry = get_task_profile_registry();
+	std::lock_guard<std::mutex> locked(registry.slots_lock);
+	for (task_profile_slot* slot: registry.slots) {
+		if (!slot->in_use) {
+			slot->in_use = true;
+			return slot;
+		}
+	}
+	task_profile_slot* slot = new task_profile_slot;
+	registry.slots.push_back(slot);
+	return slot;
+}
+
+static void release_task_profile_slot(void* slot)
+{
+	task_profile_registry& registry = get_task_profile_registry();
+	std::lock_guard<std::mutex> locked(registry.slots_lock);
+	static_cast<task_profile_slot*>(slot)->in_use = false;
+}
+
+#if defined(EMULATE_PTHREAD_THREAD_LOCAL)
+// Use a pthread key destructor to release the slot on thread exit
+struct pthread_emulation_task_profile_initializer {
+	pthread_key_t key;
+
+	pthread_emulation_task_profile_initializer()
+	{
+		pthread_key_create(&key, release_task_profile_slot);
+	}
+
+	~pthread_emulation_task_profile_initializer()
+	{
+		pthread_key_delete(key);
+	}
+};
+
+static pthread_key_t get_task_profile_key()
+{
+	static pthread_emulation_task_profile_initializer initializer;
+	return initializer.key;
+}
+
+static task_profile_slot* get_task_profile_slot()
+{
+	void* slot = pthread_getspecific(get_task_profile_key());
+	if (!slot) {
+		slot = acquire_task_profile_slot();
+		pthread_setspecific(get_task_profile_key(), slot);
+	}
+	return static_cast<task_profile_slot*>(slot);
+}
+#else
+// Releases the current thread's slot when the thread exits. This needs a
+// destructor so it can't use THREAD_LOCAL (see internal.h), which is why the
+// slot pointer is kept in a separate variable that is cheaper to access.
+struct task_profile_slot_owner {
+	task_profile_slot* slot;
+
+	~task_profile_slot_owner()
+	{
+		if (slot)
+			release_task_profile_slot(slot);
+	}
+};
+static thread_local task_profile_slot_owner profile_slot_owner = {nullptr};
+static THREAD_LOCAL task_profile_slot* current_profile_slot;
+
+static task_profile_slot* get_task_profile_slot()
+{
+	task_profile_slot* slot = current_profile_slot;
+	if (!slot) {
+		slot = acquire_task_profile_slot();
+		profile_slot_owner.slot = slot;
+		current_profile_slot = slot;
+	}
+	return slot;
+}
+#endif
+
+task_profile_context task_profile_begin() LIBASYNC_NOEXCEPT
+{
+	task_profile_slot* slot = get_task_profile_slot();
+	task_profile_context saved = {task_stats_now(), slot->nested_time};
+	slot->nested_time = 0;
+	return saved;
+}
+
+void task_profile_end(const task_profile_entry& entry, std::uint64_t schedule_time, const task_profile_context& saved) LIBASYNC_NOEXCEPT
+{
+	std::uint64_t end_time = task_stats_now();
+	task_profile_slot* slot = get_task_profile_slot();
+	std::uint64_t total = end_time - saved.start_time;
+	std::uint64_t elapsed = slot->nested_time < total ? total - slot->nested_time : 0;
+	slot->nested_time = saved.nested_time + total;
+
+	slot->apply_reset();
+	task_profile_counters* counters = slot->counters(entry.index);
+	if (!counters)
+		return;
+	counters->count.store(counters->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	counters->run_time.store(counters->run_time.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+	counters->queue_delay.store(counters->queue_delay.load(std::memory_order_relaxed) + (saved.start_time - schedule_time), std::memory_order_relaxed);
+	if (elapsed > counters->max_run_time.load(std::memory_order_relaxed))
+		counters->max_run_time.store(elapsed, std::memory_order_relaxed);
+}
+
+// Extract the type name from the signature returned by task_type_name()
+static std::string clean_type_name(const char* signature)
+{
+	std::string name = signature;
+#ifdef _MSC_VER
+	// "const char *__cdecl async::detail::task_type_name<TYPE>(void)"
+	std::size_t begin = name.find("task_type_name<");
+	std::size_t end = name.rfind(">(void)");
+	if (begin != std::string::npos && end != std::string::npos && end > begin + 15)
+		return name.substr(begin + 15, end - begin - 15);
+#else
+	// GCC: "const char* async::detail::task_type_name() [with T = TYPE]"
+	// Clang: "const char *async::detail::task_type_name() [T = TYPE]"
+	std::size_t begin = name.find("T = ");
+	std::size_t end = name.rfind(']');
+	if (begin != std::string::npos && end != std::string::npos && end > begin + 4)
+		return name.substr(begin + 4, end - begin - 4);
+#endif
+	return name;
+}
+#endif
+
+} // namespace detail
+
+bool task_profile_enabled() LIBASYNC_NOEXCEPT
+{
+#ifdef LIBASYNC_TASK_PROFILE
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::vector<task_profile_record> get_task_profile()
+{
+	std::vector<task_profile_record> out;
+#ifdef LIBASYNC_TASK_PROFILE
+	detail::task_profile_registry& registry = detail::get_task_profile_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	std::lock_guard<std::mutex> slots_locked(registry.slots_lock);
+	for (detail::task_profile_entry* entry = registry.head; entry; entry = entry->next) {
+		task_profile_record record;
+		record.count = record.run_time = record.max_run_time = record.queue_delay = 0;
+
+		// Sum the counters of all threads
+		std::size_t block_index = entry->index / detail::task_profile_block_size;
+		if (block_index >= detail::task_profile_max_blocks)
+			continue;
+		for (detail::task_profile_slot* slot: registry.slots) {
+			if (!slot->reset_applied())
+				continue;
+			detail::task_profile_counters* block = slot->blocks[block_index].load(std::memory_order_acquire);
+			if (!block)
+				continue;
+			const detail::task_profile_counters& counters = block[entry->index % detail::task_profile_block_size];
+			record.count += counters.count.load(std::memory_order_relaxed);
+			record.run_time += counters.run_time.load(std::memory_order_relaxed);
+			record.max_run_time = std::max(record.max_run_time, counters.max_run_time.load(std::memory_order_relaxed));
+			record.queue_delay += counters.queue_delay.load(std::memory_order_relaxed);
+		}
+		if (record.count == 0)
+			continue;
+
+		record.type_name = detail::clean_type_name(entry->type_name);
+		const char* label = entry->label.load(std::memory_order_relaxed);
+		record.name = label ? label : record.type_name;
+		out.push_back(std::move(record));
+	}
+	std::sort(out.begin(), out.end(), [](const task_profile_record& a, const task_profile_record& b) {
+		return a.run_time > b.run_time;
+	});
+#endif
+	return out;
+}
+
+void reset_task_profile()
+{
+#ifdef LIBASYNC_TASK_PROFILE
+	detail::task_profile_registry& registry = detail::get_task_profile_registry();
+	std::lock_guard<std::mutex> locked(registry.slots_lock);
+	for (detail::task_profile_slot* slot: registry.slots) {
+		slot->reset_epoch.store(slot->reset_epoch.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (!slot->in_use)
+			slot->apply_reset();
+	}
+#endif
+}
+
+std::string task_profile_to_table(const std::vector<task_profile_record>& profile)
+{
+	// Times are shown in microseconds, averages are per task
+	char buffer[160];
+	std::snprintf(buffer, sizeof(buffer), "%12s %14s %12s %12s %14s  %s\n",
+	              "count", "total_us", "mean_us", "max_us", "mean_queue_us", "task");
+	std::string out = buffer;
+	for (const task_profile_record& record: profile) {
+		double count = record.count ? static_cast<double>(record.count) : 1;
+		std::snprintf(buffer, sizeof(buffer), "%12llu %14.1f %12.3f %12.3f %14.3f  ",
+		              static_cast<unsigned long long>(record.count),
+		              static_cast<double>(record.run_time) / 1e3,
+		              static_cast<double>(record.run_time) / 1e3 / count,
+		              static_cast<double>(record.max_run_time) / 1e3,
+		              static_cast<double>(record.queue_delay) / 1e3 / count);
+		out += buffer;
+		out += record.name;
+		out += '\n';
+	}
+	return out;
+}
+
+} // namespace async
@@ -0,0 +1,324 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "internal.h"
+
+#include <cstdio>
+#include <limits>
+
+// for pthread thread_local emulation
+#if defined(LIBASYNC_TASK_STATS) && defined(EMULATE_PTHREAD_THREAD_LOCAL)
+# include <pthread.h>
+#endif
+
+namespace async {
+namespace detail {
+
+#ifdef LIBASYNC_TASK_STATS
+// Histogram which is written by a single thread and can be read concurrently by
+// others. Updates are plain loads and stores, so recording never locks and
+// never uses read-modify-write instructions.
+struct atomic_histogram {
+	std::atomic<std::uint64_t> counts[task_stats_histogram::bucket_count];
+	std::atomic<std::uint64_t> total;
+	std::atomic<std::uint64_t> min_value;
+	std::atomic<std::uint64_t> max_value;
+	std::atomic<std::uint64_t> sum;
+
+	atomic_histogram()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		for (std::size_t i = 0; i < task_stats_histogram::bucket_count; i++)
+			counts[i].store(0, std::memory_order_relaxed);
+		total.store(0, std::memory_order_relaxed);
+		min_value.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+		max_value.store(0, std::memory_order_relaxed);
+		sum.store(0, std::memory_order_relaxed);
+	}
+
+	// Only called by the thread owning the histogram
+	void record(std::uint64_t value)
+	{
+		std::atomic<std::uint64_t>& bucket = counts[task_stats_histogram::bucket_index(value)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		if (value < min_value.load(std::memory_order_relaxed))
+			min_value.store(value, std::memory_order_relaxed);
+		if (value > max_value.load(std::memory_order_relaxed))
+			max_value.store(value, std::memory_order_relaxed);
+	}
+
+	task_stats_histogram snapshot() const
+	{
+		task_stats_histogram out;
+		std::uint64_t min = min_value.load(std::memory_order_relaxed);
+		std::uint64_t max = max_value.load(std::memory_order_relaxed);
+		std::uint64_t values_sum = sum.load(std::memory_order_relaxed);
+		for (std::size_t i = 0; i < task_stats_histogram::bucket_count; i++) {
+			std::uint64_t count = counts[i].load(std::memory_order_relaxed);
+			if (count == 0)
+				continue;
+
+			// The sum is only added with the first bucket
+			out.add(i, count, min, max, values_sum);
+			values_sum = 0;
+		}
+		return out;
+	}
+};
+
+// Statistics recorded by one thread. Slots are never freed, when a thread
+// exits its slot is released and can be picked up by the next new thread.
+//
+// Only the owning thread writes the histograms. A reset bumps reset_epoch and
+// the owner clears its histograms on its next record, before recording into
+// them. Until then, readers treat the slot as empty.
+struct task_stats_slot {
+	atomic_histogram queue_delay;
+	atomic_histogram run_time;
+	std::atomic<std::uint64_t> reset_epoch;
+	std::atomic<std::uint64_t> applied_epoch;
+	bool in_use;
+
+	task_stats_slot()
+		: reset_epoch(0), applied_epoch(0), in_use(true) {}
+
+	// Clear the histograms if a reset is pending, only called by the owner or
+	// with the registry locked when the slot has no owner
+	void apply_reset()
+	{
+		std::uint64_t epoch = reset_epoch.load(std::memory_order_relaxed);
+		if (epoch == applied_epoch.load(std::memory_order_relaxed))
+			return;
+		queue_delay.reset();
+		run_time.reset();
+		applied_epoch.store(epoch, std::memory_order_release);
+	}
+
+	// Whether the histograms are up to date with the last reset
+	bool reset_applied() const
+	{
+		return applied_epoch.load(std::memory_order_acquire) == reset_epoch.load(std::memory_order_relaxed);
+	}
+};
+
+// List of all slots. This is deliberately leaked so that threads which exit
+// after static destructors have run can still release their slot.
+struct task_stats_registry {
+	std::mutex lock;
+	std::vector<task_stats_slot*> slots;
+};
+static task_stats_registry& get_task_stats_registry()
+{
+	static task_stats_registry* registry = new task_stats_registry;
+	return *registry;
+}
+
+static task_stats_slot* acquire_task_stats_slot()
+{
+	task_stats_registry& registry = get_task_stats_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	for (task_stats_slot* slot: registry.slots) {
+		if (!slot->in_use) {
+			slot->in_use = true;
+			return slot;
+		}
+	}
+	task_stats_slot* slot = new task_stats_slot;
+	registry.slots.push_back(slot);
+	return slot;
+}
+
+static void release_task_stats_slot(void* slot)
+{
+	task_stats_registry& registry = get_task_stats_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	static_cast<task_stats_slot*>(slot)->in_use = false;
+}
+
+#if defined(EMULATE_PTHREAD_THREAD_LOCAL)
+// Use a pthread key destructor to release the slot on thread exit
+struct pthread_emulation_task_stats_initializer {
+	pthread_key_t key;
+
+	pthread_emulation_task_stats_initializer()
+	{
+		pthread_key_create(&key, release_task_stats_slot);
+	}
+
+	~pthread_emulation_task_stats_initializer()
+	{
+		pthread_key_delete(key);
+	}
+};
+
+static pthread_key_t get_task_stats_key()
+{
+	static pthread_emulation_task_stats_initializer initializer;
+	return initializer.key;
+}
+
+static task_stats_slot* get_task_stats_slot()
+{
+	void* slot = pthread_getspecific(get_task_stats_key());
+	if (!slot) {
+		slot = acquire_task_stats_slot();
+		pthread_setspecific(get_task_stats_key(), slot);
+	}
+	return static_cast<task_stats_slot*>(slot);
+}
+#else
+// Releases the current thread's slot when the thread exits. This needs a
+// destructor so it can't use THREAD_LOCAL (see internal.h), which is why the
+// slot pointer is kept in a separate variable that is cheaper to access.
+struct task_stats_slot_owner {
+	task_stats_slot* slot;
+
+	~task_stats_slot_owner()
+	{
+		if (slot)
+			release_task_stats_slot(slot);
+	}
+};
+static thread_local task_stats_slot_owner slot_owner = {nullptr};
+static THREAD_LOCAL task_stats_slot* current_slot;
+
+static task_stats_slot* get_task_stats_slot()
+{
+	task_stats_slot* slot = current_slot;
+	if (!slot) {
+		slot = acquire_task_stats_slot();
+		slot_owner.slot = slot;
+		current_slot = slot;
+	}
+	return slot;
+}
+#endif
+
+void record_task_stats(std::uint64_t schedule_time, std::uint64_t start_time, std::uint64_t end_time) LIBASYNC_NOEXCEPT
+{
+	task_stats_slot* slot = get_task_stats_slot();
+	slot->apply_reset();
+	slot->queue_delay.record(start_time - schedule_time);
+	slot->run_time.record(end_time - start_time);
+}
+#endif
+
+// Write a histogram as a JSON object
+static void histogram_to_json(std::string& out, const task_stats_histogram& hist)
+{
+	char buffer[128];
+	std::snprintf(buffer, sizeof(buffer), "{\"count\": %llu, \"mean\": %.1f, \"min\": %llu, \"max\": %llu",
+	              static_cast<unsigned long long>(hist.count()), hist.mean(),
+	              static_cast<unsigned long long>(hist.min()), static_cast<unsigned long long>(hist.max()));
+	out += buffer;
+
+	static const double percentiles[] = {50, 90, 99, 99.9};
+	static const char* const names[] = {"p50", "p90", "p99", "p999"};
+	for (std::size_t i = 0; i < 4; i++) {
+		std::snprintf(buffer, sizeof(buffer), ", \"%s\": %llu", names[i], static_cast<unsigned long long>(hist.percentile(percentiles[i])));
+		out += buffer;
+	}
+
+	// Non-empty buckets as [lower bound, upper bound, count]
+	out += ", \"buckets\": [";
+	bool first = true;
+	for (std::size_t i = 0; i < task_stats_histogram::bucket_count; i++) {
+		if (hist.bucket(i) == 0)
+			continue;
+		std::snprintf(buffer, sizeof(buffer), "%s[%llu, %llu, %llu]", first ? "" : ", ",
+		              static_cast<unsigned long long>(task_stats_histogram::bucket_lower_bound(i)),
+		              static_cast<unsigned long long>(task_stats_histogram::bucket_upper_bound(i)),
+		              static_cast<unsigned long long>(hist.bucket(i)));
+		out += buffer;
+		first = false;
+	}
+	out += "]}";
+}
+
+} // namespace detail
+
+bool task_stats_enabled() LIBASYNC_NOEXCEPT
+{
+#ifdef LIBASYNC_TASK_STATS
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::vector<task_stats> get_thread_task_stats()
+{
+	std::vector<task_stats> out;
+#ifdef LIBASYNC_TASK_STATS
+	detail::task_stats_registry& registry = detail::get_task_stats_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	out.reserve(registry.slots.size());
+	for (detail::task_stats_slot* slot: registry.slots) {
+		out.emplace_back();
+		if (!slot->reset_applied())
+			continue;
+		out.back().queue_delay = slot->queue_delay.snapshot();
+		out.back().run_time = slot->run_time.snapshot();
+	}
+#endif
+	return out;
+}
+
+task_stats get_task_stats()
+{
+	task_stats out;
+	for (const task_stats& stats: get_thread_task_stats())
+		out.merge(stats);
+	return out;
+}
+
+void reset_task_stats()
+{
+#ifdef LIBASYNC_TASK_STATS
+	detail::task_stats_registry& registry = detail::get_task_stats_registry();
+	std::lock_guard<std::mutex> locked(registry.lock);
+	for (detail::task_stats_slot* slot: registry.slots) {
+		// Slots in use are cleared by their owner, so that a reset never races
+		// with a record
+		slot->reset_epoch.store(slot->reset_epoch.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (!slot->in_use)
+			slot->apply_reset();
+	}
+#endif
+}
+
+std::string task_stats_to_json(const task_stats& stats)
+{
+	std::string out = "{\"queue_delay\": ";
+	detail::histogram_to_json(out, stats.queue_delay);
+	out += ", \"run_time\": ";
+	detail::histogram_to_json(out, stats.run_time);
+	out += "}";
+	return out;
+}
+
+} // namespace async
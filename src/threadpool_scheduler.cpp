@@ -38,19 +38,35 @@ namespace detail {
 // 不同线程同步访问/修改自己对应槽的结构体对象
 // 为了避免cache false-sharing，最好align到cache line
 struct LIBASYNC_CACHELINE_ALIGN thread_data_t {
+	thread_data_t()
+		: mailbox_size(0), sleeping(nullptr), asleep(false) {}
+
 	work_steal_queue queue;  // 每个线程有自己local的任务队列
 	std::minstd_rand rng;
 	std::thread handle;  // 以及对应的线程体句柄
+
+	// Tasks sent to this thread specifically. The size is atomic so that it
+	// can be checked without taking the lock.
+	std::mutex mailbox_lock;
+	fifo_queue mailbox;
+	std::atomic<std::size_t> mailbox_size;
+
+	// Event this thread is sleeping on, protected by threadpool_data::lock
+	task_wait_event* sleeping;
+
+	// Set while this thread is sleeping or waking up. Other threads leave its
+	// mailbox alone in the meantime, since it will get to the tasks soon.
+	std::atomic<bool> asleep;
 };
 
 // Internal data used by threadpool_scheduler
 struct threadpool_data {
 	threadpool_data(std::size_t num_threads)
-		: thread_data(num_threads), shutdown(false), num_waiters(0), waiters(new task_wait_event*[num_threads]) {}
+		: thread_data(num_threads), shutdown(false), num_waiters(0), waiters(new task_wait_event*[num_threads]), region_owner(std::thread::id()) {}
 
     threadpool_data(std::size_t num_threads, std::function<void()>&& prerun_, std::function<void()>&& postrun_)
 		: thread_data(num_threads), shutdown(false), num_waiters(0), waiters(new task_wait_event*[num_threads]),
-          prerun(std::move(prerun_)), postrun(std::move(postrun_)) {}
+          region_owner(std::thread::id()), prerun(std::move(prerun_)), postrun(std::move(postrun_)) {}
 
 	// Mutex protecting everything except thread_data
 	std::mutex lock;
@@ -72,6 +88,11 @@ struct threadpool_data {
 	// 一个task_wait_event*数组，数组元素是task_wait_event*指针
 	std::unique_ptr<task_wait_event*[]> waiters;
 
+	// Lock held while a parallel region runs on the pool, and the thread which
+	// started that region
+	std::mutex region_lock;
+	std::atomic<std::thread::id> region_owner;
+
 	// Pre/Post run functions.
     std::function<void()> prerun;
     std::function<void()> postrun;
@@ -151,6 +172,20 @@ static threadpool_data_wrapper get_threadpool_data_wrapper()
 #endif
 }
 
+// Take a task from a thread's mailbox
+static task_run_handle pop_mailbox(thread_data_t& data)
+{
+	// Check outside the lock to avoid locking overhead in the fast path
+	if (data.mailbox_size.load(std::memory_order_relaxed) == 0)
+		return task_run_handle();
+
+	std::lock_guard<std::mutex> locked(data.mailbox_lock);
+	task_run_handle t = data.mailbox.pop();
+	if (t)
+		data.mailbox_size.fetch_sub(1, std::memory_order_relaxed);
+	return t;
+}
+
 // Try to steal a task from another thread's queue
 static task_run_handle steal_task(threadpool_data* impl, std::size_t thread_id)
 {
@@ -165,8 +200,22 @@ static task_run_handle steal_task(threadpool_data* impl, std::size_t thread_id)
 		if (i == thread_id)
 			continue;
 
-		if (task_run_handle t = impl->thread_data[i].queue.steal())
+		if (task_run_handle t = impl->thread_data[i].queue.steal()) {
+			hooks::task_stolen(t.get_id(), thread_id, i);
 			return t;
+		}
+	}
+
+	// Take tasks sent to other threads as a last resort, so that they still
+	// run if the thread they were sent to is busy.
+	for (std::size_t i: victims) {
+		if (i == thread_id || impl->thread_data[i].asleep.load(std::memory_order_relaxed))
+			continue;
+
+		if (task_run_handle t = pop_mailbox(impl->thread_data[i])) {
+			hooks::task_stolen(t.get_id(), thread_id, i);
+			return t;
+		}
 	}
 
 	// No tasks found, but we might have missed one if it was just added. In
@@ -204,6 +253,12 @@ static void thread_task_loop(threadpool_data* impl, std::size_t thread_id, task_
 			continue;
 		}
 
+		// Then check for tasks sent to this thread specifically
+		if (task_run_handle t = pop_mailbox(current_thread)) {
+			t.run();
+			continue;
+		}
+
 		// 从其它线程中偷一个task，或者从全局队列中偷一个
 		// 运行完task，会退出到上层循环，这样local队列才能被再次访问到
 		// Stealing loop
@@ -228,6 +283,11 @@ static void thread_task_loop(threadpool_data* impl, std::size_t thread_id, task_
 				break;
 			}
 
+			// A task may have been sent to this thread since we last checked,
+			// and nobody will wake us up for it unless we are in the waiter list.
+			if (current_thread.mailbox_size.load(std::memory_order_relaxed) != 0)
+				break;
+
 			// If shutting down and we don't have a task to wait for, return.
 			if (!wait_task && impl->shutdown) {
 #ifdef BROKEN_JOIN_IN_DESTRUCTOR
@@ -259,12 +319,18 @@ static void thread_task_loop(threadpool_data* impl, std::size_t thread_id, task_
 			size_t num_waiters_val = impl->num_waiters.load(std::memory_order_relaxed);
 			impl->waiters[num_waiters_val] = &event;  // 仅仅是一个local event指针
 			impl->num_waiters.store(num_waiters_val + 1, std::memory_order_relaxed);
+			current_thread.sleeping = &event;
+			current_thread.asleep.store(true, std::memory_order_relaxed);
 
 			// Wait for our event to be signaled when a task is scheduled or
 			// the task we are waiting for has completed.
 			locked.unlock();
+			hooks::worker_park(thread_id);
 			int events = event.wait();
+			hooks::worker_unpark(thread_id);
 			locked.lock();
+			current_thread.sleeping = nullptr;
+			current_thread.asleep.store(false, std::memory_order_relaxed);
 
 			// 查看`schedule`函数最后一行，提交线程已经去除了最后一个等待着
 			// Remove our thread from the list of waiting threads
@@ -283,8 +349,21 @@ static void thread_task_loop(threadpool_data* impl, std::size_t thread_id, task_
 			// Check again if the task has finished. We have added a
 			// continuation at this point, so we need to check that the
 			// continuation has finished signaling the event.
-			if (wait_task && (events & wait_type::task_finished))
+			// Tasks may have been sent to our mailbox while we were waking
+			// up, so hand them to another sleeping thread since we won't get
+			// to them until the task we are returning to is done.
+			if (wait_task && (events & wait_type::task_finished)) {
+				num_waiters_val = impl->num_waiters.load(std::memory_order_relaxed);
+				if (current_thread.mailbox_size.load(std::memory_order_relaxed) != 0 && num_waiters_val != 0) {
+					impl->waiters[num_waiters_val - 1]->signal(wait_type::task_available);
+					impl->num_waiters.store(num_waiters_val - 1, std::memory_order_relaxed);
+				}
 				return;
+			}
+
+			// Run any tasks sent to this thread before stealing again
+			if (current_thread.mailbox_size.load(std::memory_order_relaxed) != 0)
+				break;
 		}
 	}
 }
@@ -342,6 +421,40 @@ static void recursive_spawn_worker_thread(threadpool_data* impl, std::size_t ind
 	}
 }
 
+// Check whether other threads could use more work. Threads outside a thread
+// pool always hand out work, since they have no queue for others to steal from.
+bool work_requested()
+{
+	threadpool_data_wrapper wrapper = get_threadpool_data_wrapper();
+	threadpool_data* impl = wrapper.owning_threadpool;
+	if (!impl)
+		return true;
+
+	// Work is wanted if a thread is sleeping or if all the tasks we pushed onto
+	// our queue have been stolen.
+	return impl->num_waiters.load(std::memory_order_relaxed) != 0 || impl->thread_data[wrapper.thread_id].queue.empty();
+}
+
+// Start a parallel region, or tell the caller to run it alone if it is nested
+// in another region or in a task of the pool
+bool begin_region(threadpool_scheduler& sched)
+{
+	threadpool_data* impl = sched.impl.get();
+	if (!impl->region_lock.try_lock()) {
+		if (get_threadpool_data_wrapper().owning_threadpool == impl || impl->region_owner.load(std::memory_order_relaxed) == std::this_thread::get_id())
+			return false;
+		impl->region_lock.lock();
+	}
+	impl->region_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+	return true;
+}
+void end_region(threadpool_scheduler& sched)
+{
+	threadpool_data* impl = sched.impl.get();
+	impl->region_owner.store(std::thread::id(), std::memory_order_relaxed);
+	impl->region_lock.unlock();
+}
+
 } // namespace detail
 
 threadpool_scheduler::threadpool_scheduler(threadpool_scheduler&& other)
@@ -468,6 +581,62 @@ void threadpool_scheduler::schedule(task_run_handle t)
 	}
 }
 
+// Schedule a task on a specific thread of the thread pool
+void threadpool_scheduler::schedule_on(std::size_t thread, task_run_handle t)
+{
+	detail::threadpool_data_wrapper wrapper = detail::get_threadpool_data_wrapper();
+
+	// Use the normal path for invalid indices and for the current thread
+	if (thread >= impl->thread_data.size() || (wrapper.owning_threadpool == impl.get() && wrapper.thread_id == thread)) {
+		schedule(std::move(t));
+		return;
+	}
+
+	// Push the task into the thread's mailbox
+	detail::thread_data_t& target = impl->thread_data[thread];
+	{
+		std::lock_guard<std::mutex> locked(target.mailbox_lock);
+		target.mailbox.push(std::move(t));
+		target.mailbox_size.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Wake up the thread if it is sleeping. Otherwise it may be busy with a
+	// long task, so wake up another thread which can take the task from its
+	// mailbox.
+	std::lock_guard<std::mutex> locked(impl->lock);
+	size_t num_waiters_val = impl->num_waiters.load(std::memory_order_relaxed);
+	if (!target.sleeping) {
+		if (num_waiters_val == 0)
+			return;
+		impl->waiters[num_waiters_val - 1]->signal(detail::wait_type::task_available);
+		impl->num_waiters.store(num_waiters_val - 1, std::memory_order_relaxed);
+		return;
+	}
+	for (std::size_t i = 0; i < num_waiters_val; i++) {
+		if (impl->waiters[i] == target.sleeping) {
+			impl->waiters[i]->signal(detail::wait_type::task_available);
+			if (i != num_waiters_val - 1)
+				std::swap(impl->waiters[i], impl->waiters[num_waiters_val - 1]);
+			impl->num_waiters.store(num_waiters_val - 1, std::memory_order_relaxed);
+			break;
+		}
+	}
+}
+
+std::size_t threadpool_scheduler::num_threads() const
+{
+	return impl->thread_data.size();
+}
+
+std::size_t threadpool_scheduler::current_thread_index() const
+{
+	detail::threadpool_data_wrapper wrapper = detail::get_threadpool_data_wrapper();
+	if (wrapper.owning_threadpool == impl.get())
+		return wrapper.thread_id;
+	else
+		return static_cast<std::size_t>(-1);
+}
+
 } // namespace async
 
 #ifndef LIBASYNC_STATIC
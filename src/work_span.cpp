@@ -0,0 +1,277 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "internal.h"
+
+#include <cstdio>
+
+// for pthread thread_local emulation
+#if defined(LIBASYNC_WORK_SPAN) && defined(EMULATE_PTHREAD_THREAD_LOCAL)
+# include <pthread.h>
+#endif
+
+namespace async {
+namespace detail {
+
+#ifdef LIBASYNC_WORK_SPAN
+// Totals for a region
+struct work_span_data {
+	std::atomic<std::uint64_t> work;
+	std::atomic<std::uint64_t> span;
+	std::atomic<std::uint64_t> burdened_span;
+	std::atomic<std::uint64_t> tasks;
+	std::uint64_t spawn_burden;
+
+	explicit work_span_data(std::uint64_t spawn_burden_)
+		: work(0), span(0), burdened_span(0), tasks(0), spawn_burden(spawn_burden_) {}
+};
+
+static std::uint64_t work_span_now()
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#if defined(EMULATE_PTHREAD_THREAD_LOCAL)
+struct pthread_emulation_work_span_initializer {
+	pthread_key_t key;
+
+	pthread_emulation_work_span_initializer()
+	{
+		pthread_key_create(&key, [](void* context_ptr) {
+			delete static_cast<work_span_context*>(context_ptr);
+		});
+	}
+
+	~pthread_emulation_work_span_initializer()
+	{
+		pthread_key_delete(key);
+	}
+};
+
+static work_span_context& get_work_span_context()
+{
+	static pthread_emulation_work_span_initializer initializer;
+	work_span_context* context = static_cast<work_span_context*>(pthread_getspecific(initializer.key));
+	if (!context) {
+		context = new work_span_context();
+		pthread_setspecific(initializer.key, context);
+	}
+	return *context;
+}
+#else
+// Strand currently running on this thread
+static THREAD_LOCAL work_span_context current_context;
+
+static work_span_context& get_work_span_context()
+{
+	return current_context;
+}
+#endif
+
+// Add the time a strand has been running since it was last resumed to its
+// span and to the work of its region
+static void advance_strand(work_span_context& context, std::uint64_t now)
+{
+	if (context.resume_time == 0)
+		return;
+	std::uint64_t elapsed = now - context.resume_time;
+	context.span += elapsed;
+	context.burdened_span += elapsed;
+	if (context.region)
+		context.region->work.fetch_add(elapsed, std::memory_order_relaxed);
+	context.resume_time = now;
+}
+
+void work_span_task_created(task_base* t, bool spawned) LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	if (!context.region)
+		return;
+	advance_strand(context, work_span_now());
+	t->ws_region = context.region;
+	t->ws_span.store(context.span, std::memory_order_relaxed);
+	t->ws_burdened_span.store(context.burdened_span, std::memory_order_relaxed);
+	if (spawned)
+		context.region->tasks.fetch_add(1, std::memory_order_relaxed);
+}
+
+work_span_context work_span_task_begin(task_base* t, bool spawned) LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	std::uint64_t now = work_span_now();
+	advance_strand(context, now);
+	work_span_context saved = context;
+	context.region = t->ws_region;
+	context.span = t->ws_span.load(std::memory_order_relaxed);
+	context.burdened_span = t->ws_burdened_span.load(std::memory_order_relaxed);
+	if (spawned && t->ws_region)
+		context.burdened_span += t->ws_region->spawn_burden;
+	context.resume_time = t->ws_region ? now : 0;
+	return saved;
+}
+
+void work_span_task_end(const work_span_context& saved) LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	std::uint64_t now = work_span_now();
+	advance_strand(context, now);
+
+	// The interrupted strand continues from now if it was running
+	context = saved;
+	if (context.resume_time != 0)
+		context.resume_time = now;
+}
+
+void work_span_task_finished(task_base* t) LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	if (!context.region)
+		return;
+	advance_strand(context, work_span_now());
+	work_span_max(t->ws_span, context.span);
+	work_span_max(t->ws_burdened_span, context.burdened_span);
+	work_span_max(context.region->span, context.span);
+	work_span_max(context.region->burdened_span, context.burdened_span);
+}
+
+void work_span_pause() LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	advance_strand(context, work_span_now());
+	context.resume_time = 0;
+}
+
+void work_span_resume() LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	if (context.region)
+		context.resume_time = work_span_now();
+}
+
+void work_span_join(std::uint64_t span, std::uint64_t burdened_span) LIBASYNC_NOEXCEPT
+{
+	work_span_context& context = get_work_span_context();
+	if (!context.region)
+		return;
+	advance_strand(context, work_span_now());
+	context.span = std::max(context.span, span);
+	context.burdened_span = std::max(context.burdened_span, burdened_span);
+}
+#endif
+
+} // namespace detail
+
+struct work_span_region::internal_data {
+	std::string name;
+	std::function<void(const work_span_report&)> handler;
+#ifdef LIBASYNC_WORK_SPAN
+	detail::work_span_data data;
+
+	// Strand which was running before the region started
+	detail::work_span_context saved;
+
+	internal_data(std::string&& name_, std::function<void(const work_span_report&)>&& handler_, std::uint64_t spawn_burden)
+		: name(std::move(name_)), handler(std::move(handler_)), data(spawn_burden) {}
+#else
+	internal_data(std::string&& name_, std::function<void(const work_span_report&)>&& handler_, std::uint64_t)
+		: name(std::move(name_)), handler(std::move(handler_)) {}
+#endif
+};
+
+bool work_span_enabled() LIBASYNC_NOEXCEPT
+{
+#ifdef LIBASYNC_WORK_SPAN
+	return true;
+#else
+	return false;
+#endif
+}
+
+void print_work_span_report(const work_span_report& report)
+{
+	std::fprintf(stderr, "%s: work %.3f ms, span %.3f ms, parallelism %.2f, burdened span %.3f ms, burdened parallelism %.2f, %llu tasks\n",
+	             report.name.c_str(), static_cast<double>(report.work) / 1e6, static_cast<double>(report.span) / 1e6,
+	             report.parallelism(), static_cast<double>(report.burdened_span) / 1e6, report.burdened_parallelism(),
+	             static_cast<unsigned long long>(report.tasks));
+}
+
+work_span_region::work_span_region(std::string name, std::function<void(const work_span_report&)> handler, std::uint64_t spawn_burden)
+	: impl(new internal_data(std::move(name), std::move(handler), spawn_burden))
+{
+#ifdef LIBASYNC_WORK_SPAN
+	// Interrupt the current strand and start the root strand of the region
+	detail::work_span_context& context = detail::get_work_span_context();
+	std::uint64_t now = detail::work_span_now();
+	detail::advance_strand(context, now);
+	impl->saved = context;
+	context.region = &impl->data;
+	context.span = 0;
+	context.burdened_span = 0;
+	context.resume_time = now;
+#endif
+}
+
+work_span_region::~work_span_region()
+{
+#ifdef LIBASYNC_WORK_SPAN
+	detail::work_span_context& context = detail::get_work_span_context();
+	std::uint64_t now = detail::work_span_now();
+	detail::advance_strand(context, now);
+	detail::work_span_max(impl->data.span, context.span);
+	detail::work_span_max(impl->data.burdened_span, context.burdened_span);
+
+	// Resume the interrupted strand
+	context = impl->saved;
+	if (context.resume_time != 0)
+		context.resume_time = now;
+
+	if (impl->handler)
+		impl->handler(report());
+#endif
+}
+
+work_span_report work_span_region::report() const
+{
+	work_span_report out;
+	out.name = impl->name;
+#ifdef LIBASYNC_WORK_SPAN
+	// Include the root strand if it is still running on this thread
+	detail::work_span_context& context = detail::get_work_span_context();
+	if (context.region == &impl->data)
+		detail::advance_strand(context, detail::work_span_now());
+	out.work = impl->data.work.load(std::memory_order_relaxed);
+	out.span = impl->data.span.load(std::memory_order_relaxed);
+	out.burdened_span = impl->data.burdened_span.load(std::memory_order_relaxed);
+	if (context.region == &impl->data) {
+		out.span = std::max(out.span, context.span);
+		out.burdened_span = std::max(out.burdened_span, context.burdened_span);
+	}
+	out.tasks = impl->data.tasks.load(std::memory_order_relaxed);
+#else
+	out.work = 0;
+	out.span = 0;
+	out.burdened_span = 0;
+	out.tasks = 0;
+#endif
+	return out;
+}
+
+} // namespace async
@@ -156,6 +156,15 @@ public:
 		return task_run_handle::from_void_ptr(x);
 	}
 
+	// Check whether this thread's queue is empty. This is only an estimate
+	// since other threads may be stealing from the queue concurrently.
+	bool empty() const
+	{
+		std::size_t b = bottom.load(std::memory_order_relaxed);
+		std::size_t t = top.load(std::memory_order_relaxed);
+		return to_signed(b - t) <= 0;
+	}
+
 	// Steal a task from the top of this thread's queue
 	task_run_handle steal()
 	{
@@ -0,0 +1,117 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of combinable
+
+#include "test.h"
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+TEST(sum)
+{
+	async::combinable<long> sum;
+	async::parallel_for(async::static_partitioner(async::irange(0, 100000), 64), [&sum](int i) {
+		sum.local() += i;
+	});
+	CHECK(sum.combine([](long a, long b) {
+		return a + b;
+	}) == 100000L * 99999 / 2);
+}
+
+// Each thread's value is created once with the init function
+TEST(init_function)
+{
+	async::threadpool_scheduler pool(4);
+	std::atomic<int> created(0);
+	async::combinable<std::vector<int>> values(pool, [&created] {
+		created++;
+		return std::vector<int>();
+	});
+	async::parallel_for(pool, async::static_partitioner(async::irange(0, 10000), 16), [&values](int i) {
+		values.local().push_back(i);
+	});
+	std::set<int> all;
+	int visited = 0;
+	values.combine_each([&all, &visited](const std::vector<int>& v) {
+		all.insert(v.begin(), v.end());
+		visited++;
+	});
+	CHECK(all.size() == 10000);
+	CHECK(visited == created.load());
+	CHECK(created.load() >= 1 && created.load() <= 5);
+}
+
+// Threads outside the pool get their own values
+TEST(foreign_threads)
+{
+	async::threadpool_scheduler pool(2);
+	async::combinable<int> counts(pool);
+	bool exists = true;
+	counts.local(exists) = 1;
+	CHECK(!exists);
+	counts.local(exists)++;
+	CHECK(exists);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.emplace_back([&counts] {
+			for (int j = 0; j < 1000; j++)
+				counts.local()++;
+		});
+	}
+	for (std::thread& t: threads)
+		t.join();
+	int visited = 0;
+	counts.combine_each([&visited](int) {
+		visited++;
+	});
+	CHECK(visited == 5);
+	CHECK(counts.combine([](int a, int b) {
+		return a + b;
+	}) == 4002);
+}
+
+TEST(clear)
+{
+	async::combinable<int> counts([] {
+		return 7;
+	});
+	CHECK(counts.combine([](int a, int b) {
+		return a + b;
+	}) == 7);
+	counts.local() += 1;
+	CHECK(counts.combine([](int a, int b) {
+		return a + b;
+	}) == 8);
+	counts.clear();
+	int visited = 0;
+	counts.combine_each([&visited](int) {
+		visited++;
+	});
+	CHECK(visited == 0);
+	CHECK(counts.local() == 7);
+}
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,96 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Hooks used by the hooks test, which count how many times each hook is called.
+// The test program is built with its own copy of the library so that the
+// library and the headers both use them.
+
+#ifndef ASYNCXX_COUNTING_HOOKS_H_
+#define ASYNCXX_COUNTING_HOOKS_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace test {
+
+enum hook_id {
+	hook_task_created,
+	hook_task_scheduled,
+	hook_task_started,
+	hook_task_finished,
+	hook_task_canceled,
+	hook_task_stolen,
+	hook_worker_park,
+	hook_worker_unpark,
+	hook_continuation_added,
+	hook_count
+};
+
+inline std::atomic<long>& hook_calls(hook_id id)
+{
+	static std::atomic<long> calls[hook_count];
+	return calls[id];
+}
+
+struct counting_hooks {
+	static void task_created(const void*)
+	{
+		hook_calls(hook_task_created)++;
+	}
+	static void task_scheduled(const void*)
+	{
+		hook_calls(hook_task_scheduled)++;
+	}
+	static void task_started(const void*)
+	{
+		hook_calls(hook_task_started)++;
+	}
+	static void task_finished(const void*)
+	{
+		hook_calls(hook_task_finished)++;
+	}
+	static void task_canceled(const void*)
+	{
+		hook_calls(hook_task_canceled)++;
+	}
+	static void task_stolen(const void*, std::size_t, std::size_t)
+	{
+		hook_calls(hook_task_stolen)++;
+	}
+	static void worker_park(std::size_t)
+	{
+		hook_calls(hook_worker_park)++;
+	}
+	static void worker_unpark(std::size_t)
+	{
+		hook_calls(hook_worker_unpark)++;
+	}
+	static void continuation_added(const void*, const void*)
+	{
+		hook_calls(hook_continuation_added)++;
+	}
+};
+
+} // namespace test
+
+#define LIBASYNC_HOOKS test::counting_hooks
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the algorithms taking an execution policy
+
+#include "test.h"
+#include <atomic>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Function objects with a non-const call operator are accepted, as with the
+// standard parallel algorithms
+TEST(mutable_functors)
+{
+	std::vector<int> in(100000);
+	std::iota(in.begin(), in.end(), 0);
+	std::vector<long> out(in.size());
+	long n = static_cast<long>(in.size());
+	int calls = 0;
+
+	std::atomic<long> sum(0);
+	async::for_each(async::execution::par, in.begin(), in.end(), [&sum, calls](int x) mutable {
+		calls++;
+		sum += x;
+	});
+	CHECK(sum.load() == n * (n - 1) / 2);
+
+	async::transform(async::execution::par, in.begin(), in.end(), out.begin(), [calls](int x) mutable {
+		calls++;
+		return 2 * static_cast<long>(x);
+	});
+	CHECK(out[10] == 20);
+
+	async::transform(async::execution::par, in.begin(), in.end(), in.begin(), out.begin(), [calls](int x, int y) mutable {
+		calls++;
+		return static_cast<long>(x) + y;
+	});
+	CHECK(out[n - 1] == 2 * (n - 1));
+
+	long total = async::reduce(async::execution::par, out.begin(), out.end(), 0L, [calls](long a, long b) mutable {
+		calls++;
+		return a + b;
+	});
+	CHECK(total == n * (n - 1));
+
+	total = async::transform_reduce(async::execution::par, in.begin(), in.end(), 0L, [calls](long a, long b) mutable {
+		calls++;
+		return a + b;
+	}, [calls](int x) mutable {
+		calls++;
+		return static_cast<long>(x);
+	});
+	CHECK(total == n * (n - 1) / 2);
+}
+
+// Reductions over empty and single element ranges only use the initial value
+// and that element
+TEST(reduce_small_ranges)
+{
+	std::vector<int> v;
+	CHECK(async::reduce(async::execution::par, v.begin(), v.end(), 5) == 5);
+	v.push_back(3);
+	CHECK(async::reduce(async::execution::par, v.begin(), v.end(), 5) == 8);
+	CHECK(async::transform_reduce(async::execution::par, v.begin(), v.end(), 1, std::multiplies<int>(), [](int x) {
+		return x + 1;
+	}) == 4);
+}
+
+// Partial results are combined in order, so an associative but non-commutative
+// reduction gives the same result as a serial one
+TEST(reduce_order)
+{
+	std::vector<std::string> in;
+	std::string expected;
+	for (int i = 0; i < 10000; i++) {
+		in.push_back(std::to_string(i % 10));
+		expected += in.back();
+	}
+	std::string out = async::reduce(async::execution::par, in.begin(), in.end(), std::string(">"));
+	CHECK(out == ">" + expected);
+}
+
+} // namespace
+
+TEST_MAIN()
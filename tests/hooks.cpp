@@ -0,0 +1,117 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the instrumentation hooks, using the hooks in counting_hooks.h
+
+#include "test.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Number of calls of each hook since the last call of reset_calls()
+long baseline[test::hook_count];
+
+void reset_calls()
+{
+	for (int i = 0; i < test::hook_count; i++)
+		baseline[i] = test::hook_calls(static_cast<test::hook_id>(i)).load();
+}
+
+long calls(test::hook_id id)
+{
+	return test::hook_calls(id).load() - baseline[id];
+}
+
+TEST(inline_task)
+{
+	reset_calls();
+	async::spawn(async::inline_scheduler(), [] {}).get();
+	CHECK(calls(test::hook_task_created) == 1);
+	CHECK(calls(test::hook_task_scheduled) == 1);
+	CHECK(calls(test::hook_task_started) == 1);
+	CHECK(calls(test::hook_task_finished) == 1);
+	CHECK(calls(test::hook_task_canceled) == 0);
+}
+
+// Continuations attached to a task which hasn't finished are reported, and
+// run when the task is
+TEST(continuation)
+{
+	reset_calls();
+	async::event_task<void> e;
+	auto t = e.get_task().then(async::inline_scheduler(), [] {});
+	CHECK(calls(test::hook_task_created) == 1);
+	CHECK(calls(test::hook_continuation_added) == 1);
+	CHECK(calls(test::hook_task_started) == 0);
+	e.set();
+	t.get();
+	CHECK(calls(test::hook_task_started) == 1);
+	CHECK(calls(test::hook_task_finished) == 1);
+}
+
+#ifndef LIBASYNC_NO_EXCEPTIONS
+// A task which throws finishes and is canceled, and so are its continuations
+TEST(canceled)
+{
+	reset_calls();
+	auto t = async::spawn(async::inline_scheduler(), [] {
+		throw std::runtime_error("canceled");
+	});
+	CHECK(calls(test::hook_task_started) == 1);
+	CHECK(calls(test::hook_task_finished) == 1);
+	CHECK(calls(test::hook_task_canceled) == 1);
+	auto cont = t.then(async::inline_scheduler(), [] {});
+	CHECK(calls(test::hook_task_canceled) == 2);
+	bool thrown = false;
+	try {
+		cont.get();
+	} catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+#endif
+
+// Every task run by the thread pool starts and finishes, and idle workers go
+// to sleep
+TEST(thread_pool)
+{
+	reset_calls();
+	std::vector<async::task<void>> tasks;
+	for (int i = 0; i < 100; i++)
+		tasks.push_back(async::spawn([] {}));
+	async::when_all(tasks).get();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while ((calls(test::hook_task_finished) < calls(test::hook_task_started) || calls(test::hook_worker_park) == 0) && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	CHECK(calls(test::hook_task_created) >= 100);
+	CHECK(calls(test::hook_task_scheduled) >= 100);
+	CHECK(calls(test::hook_task_started) >= 100);
+	CHECK(calls(test::hook_task_finished) == calls(test::hook_task_started));
+	CHECK(calls(test::hook_worker_park) >= 1);
+	CHECK(calls(test::hook_worker_unpark) <= calls(test::hook_worker_park));
+}
+
+} // namespace
+
+TEST_MAIN()
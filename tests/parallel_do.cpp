@@ -0,0 +1,115 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_do over initial and fed items
+
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Every initial item is processed exactly once
+TEST(initial_items)
+{
+	for (int n: {0, 1, 2, 15, 16, 17, 1000}) {
+		std::vector<int> items;
+		for (int i = 0; i < n; i++)
+			items.push_back(i);
+		std::vector<std::atomic<int>> counts(n);
+		for (auto& i: counts)
+			i = 0;
+		async::parallel_do(items, [&counts](int i) {
+			counts[i]++;
+		});
+		bool all_once = true;
+		for (auto& i: counts)
+			all_once &= i.load() == 1;
+		CHECK(all_once);
+	}
+}
+
+// Items fed by the body are processed too, including when there are enough of
+// them to be handed off to other tasks
+TEST(fed_items)
+{
+	const int n = 100000;
+	std::vector<std::atomic<int>> counts(n);
+	for (auto& i: counts)
+		i = 0;
+	async::parallel_do({0}, [&counts](int i, async::parallel_do_feeder<int>& feeder) {
+		counts[i]++;
+		for (int child: {2 * i + 1, 2 * i + 2}) {
+			if (child < n)
+				feeder.add(child);
+		}
+	});
+	bool all_once = true;
+	for (auto& i: counts)
+		all_once &= i.load() == 1;
+	CHECK(all_once);
+}
+
+// A few initial items which don't feed anything are still run in parallel.
+// Each item waits until all of them have started, which only happens if they
+// are on different threads.
+TEST(initial_items_in_parallel)
+{
+	async::threadpool_scheduler pool(4);
+	std::atomic<int> started(0);
+	std::atomic<bool> timed_out(false);
+	async::parallel_do(pool, {0, 1, 2, 3}, [&](int) {
+		started++;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (started.load() != 4) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				timed_out = true;
+				return;
+			}
+			std::this_thread::yield();
+		}
+	});
+	CHECK(!timed_out.load());
+}
+
+#ifndef LIBASYNC_NO_EXCEPTIONS
+// The first exception thrown by the body is rethrown once all tasks are done
+TEST(exception)
+{
+	std::vector<int> items(1000, 1);
+	items[500] = 0;
+	bool thrown = false;
+	try {
+		async::parallel_do(items, [](int i) {
+			if (i == 0)
+				throw std::runtime_error("item");
+		});
+	} catch (std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+#endif
+
+} // namespace
+
+TEST_MAIN()
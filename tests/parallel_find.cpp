@@ -0,0 +1,115 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the early-exit search algorithms
+
+#include "test.h"
+#include <list>
+#include <vector>
+
+namespace {
+
+// The first match is found wherever it is in the range, even if there is a
+// later one, and the end of the range is returned if there is none
+TEST(find_first)
+{
+	std::vector<int> v(10000, 0);
+	for (std::size_t pos: {std::size_t(0), std::size_t(1), std::size_t(4999), std::size_t(9999)}) {
+		v[pos] = 1;
+		v[9999] = 1;
+		auto it = async::parallel_find_first(v, [](int x) {
+			return x == 1;
+		});
+		CHECK(it - v.begin() == static_cast<std::ptrdiff_t>(pos));
+		v[pos] = 0;
+		v[9999] = 0;
+	}
+	CHECK(async::parallel_find_first(v, [](int x) {
+		return x == 1;
+	}) == v.end());
+}
+
+// Any match may be returned by parallel_find_if, but it must be a match
+TEST(find_if)
+{
+	std::vector<int> v(10000);
+	for (std::size_t i = 0; i < v.size(); i++)
+		v[i] = i % 1000 == 999;
+	auto it = async::parallel_find_if(v, [](int x) {
+		return x == 1;
+	});
+	CHECK(it != v.end() && *it == 1);
+}
+
+// Positions are carried down the recursion, so ranges without random access
+// iterators find the right element too
+TEST(find_in_list)
+{
+	std::list<int> l;
+	for (int i = 0; i < 5000; i++)
+		l.push_back(i);
+	auto it = async::parallel_find_first(l, [](int x) {
+		return x >= 1234;
+	});
+	CHECK(it != l.end() && *it == 1234);
+	it = async::parallel_find_first(async::static_partitioner(l, 7), [](int x) {
+		return x % 1000 == 999;
+	});
+	CHECK(it != l.end() && *it == 999);
+}
+
+TEST(empty_and_single)
+{
+	std::vector<int> v;
+	CHECK(async::parallel_find_first(v, [](int) {
+		return true;
+	}) == v.end());
+	CHECK(!async::parallel_any_of(v, [](int) {
+		return true;
+	}));
+	CHECK(async::parallel_all_of(v, [](int) {
+		return false;
+	}));
+	v.push_back(5);
+	CHECK(async::parallel_find_first(v, [](int x) {
+		return x == 5;
+	}) == v.begin());
+}
+
+TEST(any_all_none)
+{
+	std::vector<int> v(10000, 2);
+	auto is_even = [](int x) {
+		return x % 2 == 0;
+	};
+	auto is_odd = [](int x) {
+		return x % 2 != 0;
+	};
+	CHECK(async::parallel_all_of(v, is_even));
+	CHECK(async::parallel_none_of(v, is_odd));
+	v[7777] = 3;
+	CHECK(!async::parallel_all_of(v, is_even));
+	CHECK(async::parallel_any_of(v, is_odd));
+	CHECK(!async::parallel_none_of(v, is_odd));
+}
+
+} // namespace
+
+TEST_MAIN()
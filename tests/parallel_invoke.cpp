@@ -0,0 +1,106 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_invoke over a range of functions
+
+#include "test.h"
+#include <atomic>
+#include <functional>
+#include <list>
+#include <vector>
+
+namespace {
+
+// Functions which count how many times each of them was called
+struct counted_functions {
+	std::vector<std::atomic<int>> calls;
+	std::list<std::function<void()>> funcs;
+
+	explicit counted_functions(int n)
+		: calls(n)
+	{
+		for (int i = 0; i < n; i++) {
+			calls[i] = 0;
+			std::atomic<int>* counter = &calls[i];
+			funcs.push_back([counter] {
+				(*counter)++;
+			});
+		}
+	}
+
+	bool all_called_once() const
+	{
+		for (auto& i: calls) {
+			if (i.load() != 1)
+				return false;
+		}
+		return true;
+	}
+};
+
+// Every function in a non-random-access range is called exactly once
+TEST(list_of_functions)
+{
+	for (int n: {0, 1, 2, 3, 17, 1000}) {
+		counted_functions f(n);
+		async::parallel_invoke(f.funcs);
+		CHECK(f.all_called_once());
+	}
+}
+
+// Cost hints only change where the range is split
+TEST(with_costs)
+{
+	for (int n: {1, 2, 5, 100}) {
+		counted_functions f(n);
+		std::vector<int> costs;
+		for (int i = 0; i < n; i++)
+			costs.push_back(i % 3 == 0 ? 100 : 1);
+		async::parallel_invoke(f.funcs, costs);
+		CHECK(f.all_called_once());
+	}
+
+	// All of the cost is on one function
+	counted_functions f(10);
+	std::vector<double> costs(10, 0.0);
+	costs[9] = 1.0;
+	async::parallel_invoke(f.funcs, costs);
+	CHECK(f.all_called_once());
+}
+
+#if !defined(LIBASYNC_NO_EXCEPTIONS) && !defined(NDEBUG)
+// The number of costs is only checked in debug builds
+TEST(cost_count_mismatch)
+{
+	counted_functions f(4);
+	std::vector<int> costs(3, 1);
+	bool thrown = false;
+	try {
+		async::parallel_invoke(f.funcs, costs);
+	} catch (std::invalid_argument&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+#endif
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,139 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_merge
+
+#include "test.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Element tagged with the input it came from and its position in that input
+struct tagged {
+	int key;
+	int source;
+	std::size_t index;
+};
+
+bool key_less(const tagged& a, const tagged& b)
+{
+	return a.key < b.key;
+}
+
+// Sorted input of n elements drawn from a few keys so that there are many ties
+std::vector<tagged> tagged_input(std::mt19937& rng, std::size_t n, int source)
+{
+	std::vector<int> keys(n);
+	for (auto& k: keys)
+		k = static_cast<int>(rng() % 8);
+	std::sort(keys.begin(), keys.end());
+	std::vector<tagged> v(n);
+	for (std::size_t i = 0; i < n; i++)
+		v[i] = tagged{keys[i], source, i};
+	return v;
+}
+
+// Pairs of input lengths, including empty inputs and merges above the cutoff
+std::vector<std::pair<std::size_t, std::size_t>> merge_sizes()
+{
+	return {{0, 0}, {0, 1}, {1, 0}, {0, 5000}, {5000, 0}, {1, 1}, {1000, 1048}, {1000, 1049}, {3000, 70000}, {70000, 3000}, {50000, 50000}};
+}
+
+TEST(merge)
+{
+	std::mt19937 rng(1);
+	for (auto sizes: merge_sizes()) {
+		std::vector<int> a(sizes.first), b(sizes.second);
+		for (auto& i: a)
+			i = static_cast<int>(rng() % 1000);
+		for (auto& i: b)
+			i = static_cast<int>(rng() % 1000);
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		std::vector<int> expected, out(a.size() + b.size());
+		std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+		CHECK(async::parallel_merge(a, b, out.begin()) == out.end());
+		CHECK(out == expected);
+
+		// Descending order with a custom comparison
+		std::reverse(a.begin(), a.end());
+		std::reverse(b.begin(), b.end());
+		std::reverse(expected.begin(), expected.end());
+		async::parallel_merge(a, b, out.begin(), std::greater<int>());
+		CHECK(out == expected);
+	}
+}
+
+// Equal elements from the first input come before those from the second, and
+// each input keeps its own order
+TEST(merge_stability)
+{
+	std::mt19937 rng(2);
+	for (auto sizes: merge_sizes()) {
+		std::vector<tagged> a = tagged_input(rng, sizes.first, 0);
+		std::vector<tagged> b = tagged_input(rng, sizes.second, 1);
+		std::vector<tagged> out(a.size() + b.size());
+		async::parallel_merge(a, b, out.begin(), key_less);
+		bool ok = true;
+		for (std::size_t i = 1; i < out.size(); i++) {
+			const tagged& x = out[i - 1];
+			const tagged& y = out[i];
+			if (x.key == y.key)
+				ok &= x.source < y.source || (x.source == y.source && x.index < y.index);
+			else
+				ok &= x.key < y.key;
+		}
+		CHECK(ok);
+	}
+}
+
+// Move-only elements can be merged through move iterators
+TEST(merge_move_only)
+{
+	std::mt19937 rng(3);
+	for (auto sizes: merge_sizes()) {
+		std::vector<std::unique_ptr<int>> a, b;
+		for (std::size_t i = 0; i < sizes.first; i++)
+			a.emplace_back(new int(static_cast<int>(rng() % 100)));
+		for (std::size_t i = 0; i < sizes.second; i++)
+			b.emplace_back(new int(static_cast<int>(rng() % 100)));
+		auto less = [](const std::unique_ptr<int>& x, const std::unique_ptr<int>& y) {
+			return *x < *y;
+		};
+		std::sort(a.begin(), a.end(), less);
+		std::sort(b.begin(), b.end(), less);
+		std::vector<std::unique_ptr<int>> out(a.size() + b.size());
+		async::parallel_merge(async::make_range(std::make_move_iterator(a.begin()), std::make_move_iterator(a.end())), async::make_range(std::make_move_iterator(b.begin()), std::make_move_iterator(b.end())), out.begin(), less);
+		CHECK(std::all_of(out.begin(), out.end(), [](const std::unique_ptr<int>& p) {
+			return p != nullptr;
+		}));
+		CHECK(std::is_sorted(out.begin(), out.end(), less));
+	}
+}
+
+} // namespace
+
+TEST_MAIN()
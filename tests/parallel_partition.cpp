@@ -0,0 +1,154 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_copy_if, parallel_remove_if and the parallel partitions
+
+#include "test.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Sizes around the block size, which is at least 2048
+std::vector<std::size_t> partition_sizes()
+{
+	return {0, 1, 2, 2047, 2048, 2049, 4097, 100000};
+}
+
+bool is_odd(int x)
+{
+	return x % 2 != 0;
+}
+
+// Input which is either random or made of a single long run of each kind
+std::vector<int> partition_input(std::mt19937& rng, std::size_t n, int kind)
+{
+	std::vector<int> v(n);
+	for (std::size_t i = 0; i < n; i++) {
+		if (kind == 0)
+			v[i] = static_cast<int>(rng() % 1000);
+		else
+			v[i] = static_cast<int>(2 * i + (i < n / 2) * kind);
+	}
+	return v;
+}
+
+TEST(copy_if)
+{
+	std::mt19937 rng(1);
+	for (std::size_t n: partition_sizes()) {
+		for (int kind = 0; kind < 2; kind++) {
+			std::vector<int> v = partition_input(rng, n, kind);
+			std::vector<int> expected, out(n);
+			std::copy_if(v.begin(), v.end(), std::back_inserter(expected), is_odd);
+			auto end = async::parallel_copy_if(v, out.begin(), is_odd);
+			CHECK(static_cast<std::size_t>(end - out.begin()) == expected.size());
+			CHECK(std::equal(expected.begin(), expected.end(), out.begin()));
+		}
+	}
+}
+
+TEST(remove_if)
+{
+	std::mt19937 rng(2);
+	for (std::size_t n: partition_sizes()) {
+		for (int kind = 0; kind < 2; kind++) {
+			std::vector<int> v = partition_input(rng, n, kind);
+			std::vector<int> expected = v;
+			expected.erase(std::remove_if(expected.begin(), expected.end(), is_odd), expected.end());
+			auto end = async::parallel_remove_if(v, is_odd);
+			CHECK(static_cast<std::size_t>(end - v.begin()) == expected.size());
+			CHECK(std::equal(expected.begin(), expected.end(), v.begin()));
+		}
+	}
+}
+
+TEST(partition)
+{
+	std::mt19937 rng(3);
+	for (std::size_t n: partition_sizes()) {
+		for (int kind = 0; kind < 2; kind++) {
+			std::vector<int> v = partition_input(rng, n, kind);
+			std::vector<int> sorted = v;
+			auto split = async::parallel_partition(v, is_odd);
+			CHECK(std::is_partitioned(v.begin(), v.end(), is_odd));
+			CHECK(split == std::partition_point(v.begin(), v.end(), is_odd));
+
+			// The elements are only reordered
+			std::sort(sorted.begin(), sorted.end());
+			std::sort(v.begin(), v.end());
+			CHECK(v == sorted);
+		}
+	}
+}
+
+// Both parts keep the relative order of their elements
+TEST(stable_partition)
+{
+	std::mt19937 rng(4);
+	for (std::size_t n: partition_sizes()) {
+		for (int kind = 0; kind < 2; kind++) {
+			std::vector<int> v = partition_input(rng, n, kind);
+			std::vector<int> expected = v;
+			std::stable_partition(expected.begin(), expected.end(), is_odd);
+			auto split = async::parallel_stable_partition(v, is_odd);
+			CHECK(v == expected);
+			CHECK(split == std::partition_point(v.begin(), v.end(), is_odd));
+		}
+	}
+}
+
+// Elements are only ever moved, never copied
+TEST(move_only)
+{
+	std::mt19937 rng(5);
+	auto odd = [](const std::unique_ptr<int>& p) {
+		return is_odd(*p);
+	};
+	for (std::size_t n: partition_sizes()) {
+		std::vector<int> values = partition_input(rng, n, 0);
+		std::vector<int> expected = values;
+		std::stable_partition(expected.begin(), expected.end(), is_odd);
+
+		std::vector<std::unique_ptr<int>> v;
+		for (int i: values)
+			v.emplace_back(new int(i));
+		auto split = async::parallel_stable_partition(v, odd);
+		CHECK(static_cast<std::size_t>(split - v.begin()) == static_cast<std::size_t>(std::count_if(values.begin(), values.end(), is_odd)));
+		bool same = true;
+		for (std::size_t i = 0; i < n; i++)
+			same &= *v[i] == expected[i];
+		CHECK(same);
+
+		split = async::parallel_partition(v, odd);
+		CHECK(std::is_partitioned(v.begin(), v.end(), odd));
+
+		auto end = async::parallel_remove_if(v, odd);
+		CHECK(end == v.begin() + (v.end() - split));
+		CHECK(std::none_of(v.begin(), end, odd));
+	}
+}
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,93 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_map_reduce and parallel_reduce
+
+#include "test.h"
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+TEST(map_reduce)
+{
+	auto sum = [](long a, long b) {
+		return a + b;
+	};
+	auto square = [](int i) {
+		return static_cast<long>(i) * i;
+	};
+	long expected = 0;
+	for (int i = 0; i < 10000; i++)
+		expected += static_cast<long>(i) * i;
+	CHECK(async::parallel_map_reduce(async::irange(0, 10000), 0L, square, sum) == expected);
+	CHECK(async::parallel_map_reduce(async::irange(0, 0), 5L, square, sum) == 5);
+	CHECK(async::parallel_reduce({1, 2, 3, 4}, 0, [](int a, int b) {
+		return a + b;
+	}) == 10);
+}
+
+// Each leaf creates its accumulator with the identity factory, and the partial
+// results are combined in order
+TEST(identity_factory)
+{
+	std::atomic<int> calls(0);
+	auto identity = async::make_identity([&calls] {
+		calls++;
+		return std::vector<int>();
+	});
+	auto result = async::parallel_map_reduce(async::static_partitioner(async::irange(0, 10000), 100), identity, [](int i) {
+		return std::vector<int>(1, i);
+	}, [](std::vector<int> a, const std::vector<int>& b) {
+		a.insert(a.end(), b.begin(), b.end());
+		return a;
+	});
+	std::vector<int> expected(10000);
+	std::iota(expected.begin(), expected.end(), 0);
+	CHECK(result == expected);
+	CHECK(calls.load() >= 100);
+
+	// An empty range gives the identity
+	calls = 0;
+	CHECK(async::parallel_reduce(std::vector<std::vector<int>>(), identity, [](std::vector<int> a, const std::vector<int>&) {
+		return a;
+	}).empty());
+	CHECK(calls.load() == 1);
+}
+
+// Results are only ever moved
+TEST(move_only_result)
+{
+	auto result = async::parallel_map_reduce(async::static_partitioner(async::irange(0, 1000), 10), async::make_identity([] {
+		return std::unique_ptr<int>(new int(0));
+	}), [](int i) {
+		return std::unique_ptr<int>(new int(i));
+	}, [](std::unique_ptr<int> a, std::unique_ptr<int> b) {
+		*a += *b;
+		return a;
+	});
+	CHECK(result && *result == 1000 * 999 / 2);
+}
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,104 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_region: regions started from several threads at once on
+// the same pool, and regions nested in the ranks of another region.
+
+#include "test.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Several external threads each run a few regions with a number of barriers on
+// a shared pool. Every rank of every region must run and see the whole team.
+TEST(concurrent_regions)
+{
+	const std::size_t num_threads = 8;
+	async::threadpool_scheduler pool(num_threads);
+	std::atomic<std::size_t> ranks_run(0);
+	std::atomic<std::size_t> bad_sizes(0);
+
+	std::vector<std::thread> callers;
+	for (int c = 0; c < 4; c++) {
+		callers.emplace_back([&] {
+			for (int r = 0; r < 3; r++) {
+				async::parallel_region(pool, [&](async::team_context& team) {
+					if (team.size() != num_threads)
+						bad_sizes++;
+					for (int b = 0; b < 5; b++)
+						team.barrier();
+					ranks_run++;
+				});
+			}
+		});
+	}
+	for (auto& t: callers)
+		t.join();
+
+	CHECK(bad_sizes.load() == 0);
+	CHECK(ranks_run.load() == 4 * 3 * num_threads);
+}
+
+// A region started from a rank of another region runs on that thread alone
+TEST(nested_region)
+{
+	async::threadpool_scheduler pool(4);
+	std::atomic<std::size_t> nested_ranks(0);
+	std::atomic<std::size_t> bad_sizes(0);
+
+	async::parallel_region(pool, [&](async::team_context& team) {
+		async::parallel_region(pool, [&](async::team_context& inner) {
+			if (inner.size() != 1)
+				bad_sizes++;
+			inner.barrier();
+			nested_ranks++;
+		});
+		team.barrier();
+	});
+
+	CHECK(bad_sizes.load() == 0);
+	CHECK(nested_ranks.load() == 4);
+}
+
+// Every thread of the team takes part in a dynamic loop, and a region can be
+// started from a task of the pool once no other region is running
+TEST(region_from_task)
+{
+	async::threadpool_scheduler pool(4);
+	std::vector<int> hits(1000);
+	async::spawn(pool, [&] {
+		async::parallel_region(pool, [&](async::team_context& team) {
+			team.for_dynamic(0, 1000, 16, [&](int i) {
+				hits[i]++;
+			});
+		});
+	}).get();
+
+	bool all_once = true;
+	for (int h: hits)
+		all_once = all_once && h == 1;
+	CHECK(all_once);
+}
+
+} // namespace
+
+TEST_MAIN()
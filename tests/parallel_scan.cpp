@@ -0,0 +1,142 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the parallel scans
+
+#include "test.h"
+#include <functional>
+#include <list>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// Affine function x -> a * x + b. Composing them is associative but not
+// commutative, so scans using it check that the blocks are combined in order.
+struct affine {
+	unsigned a, b;
+
+	bool operator==(const affine& other) const
+	{
+		return a == other.a && b == other.b;
+	}
+};
+affine compose(const affine& f, const affine& g)
+{
+	return {g.a * f.a, g.a * f.b + g.b};
+}
+
+// Sizes around the block size of a scan: small inputs use a single block and
+// larger ones are split into a few blocks per thread
+std::vector<std::size_t> scan_sizes()
+{
+	std::vector<std::size_t> sizes = {0, 1, 2, 2047, 2048, 2049, 4095, 4096, 4097};
+	std::size_t large = 1 << 18;
+	std::size_t block = async::detail::scan_block_size(large);
+	for (std::size_t n: {large - 1, large, large + 1, 3 * block - 1, 3 * block, 3 * block + 1})
+		sizes.push_back(n);
+	return sizes;
+}
+
+std::vector<affine> affine_input(std::size_t n)
+{
+	std::vector<affine> out;
+	for (std::size_t i = 0; i < n; i++)
+		out.push_back({static_cast<unsigned>(i % 7 + 1), static_cast<unsigned>(i * 2654435761u)});
+	return out;
+}
+
+TEST(inclusive_scan)
+{
+	for (std::size_t n: scan_sizes()) {
+		std::vector<affine> in = affine_input(n);
+		std::vector<affine> expected(n), out(n);
+		std::partial_sum(in.begin(), in.end(), expected.begin(), compose);
+		auto end = async::parallel_inclusive_scan(in, out.begin(), compose);
+		CHECK(end == out.end());
+		CHECK(out == expected);
+
+		// With an initial value combined with the first element
+		affine init = {3, 5};
+		if (n != 0) {
+			expected[0] = compose(init, in[0]);
+			for (std::size_t i = 1; i < n; i++)
+				expected[i] = compose(expected[i - 1], in[i]);
+		}
+		async::parallel_inclusive_scan(in, out.begin(), compose, init);
+		CHECK(out == expected);
+	}
+}
+
+TEST(exclusive_scan)
+{
+	for (std::size_t n: scan_sizes()) {
+		std::vector<affine> in = affine_input(n);
+		std::vector<affine> expected(n), out(n);
+		affine init = {1, 0};
+		affine sum = init;
+		for (std::size_t i = 0; i < n; i++) {
+			expected[i] = sum;
+			sum = compose(sum, in[i]);
+		}
+		auto end = async::parallel_exclusive_scan(in, out.begin(), init, compose);
+		CHECK(end == out.end());
+		CHECK(out == expected);
+	}
+}
+
+// The output may be the input itself
+TEST(in_place_scan)
+{
+	for (std::size_t n: scan_sizes()) {
+		std::vector<long> v(n);
+		std::iota(v.begin(), v.end(), 1);
+		std::vector<long> expected(n);
+		std::partial_sum(v.begin(), v.end(), expected.begin());
+		async::parallel_inclusive_scan(v, v.begin(), std::plus<long>());
+		CHECK(v == expected);
+
+		std::iota(v.begin(), v.end(), 1);
+		if (n != 0) {
+			expected[0] = 10;
+			for (std::size_t i = 1; i < n; i++)
+				expected[i] = expected[i - 1] + static_cast<long>(i);
+		}
+		async::parallel_exclusive_scan(v, v.begin(), 10L, std::plus<long>());
+		CHECK(v == expected);
+	}
+}
+
+// Forward iterators are walked once per block to find the block boundaries
+TEST(list_scan)
+{
+	std::list<int> in;
+	for (int i = 0; i < 10000; i++)
+		in.push_back(i % 13);
+	std::list<int> out(in.size());
+	async::parallel_inclusive_scan(in, out.begin(), std::plus<int>());
+	std::vector<int> expected(in.size());
+	std::partial_sum(in.begin(), in.end(), expected.begin());
+	CHECK(std::equal(out.begin(), out.end(), expected.begin()));
+}
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,102 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of parallel_sort and parallel_stable_sort
+
+#include "test.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Sizes around the cutoff below which sequences are sorted serially
+std::vector<std::size_t> sort_sizes()
+{
+	return {0, 1, 2, 3, 2047, 2048, 2049, 4096, 4097, 100000};
+}
+
+TEST(sort)
+{
+	std::mt19937 rng(1);
+	for (std::size_t n: sort_sizes()) {
+		std::vector<int> v(n);
+		for (auto& i: v)
+			i = static_cast<int>(rng() % 1000);
+		std::vector<int> expected = v;
+		std::sort(expected.begin(), expected.end());
+		async::parallel_sort(v.begin(), v.end());
+		CHECK(v == expected);
+
+		// Already sorted input, sorted again the other way
+		std::sort(expected.begin(), expected.end(), std::greater<int>());
+		async::parallel_sort(v.begin(), v.end(), std::greater<int>());
+		CHECK(v == expected);
+	}
+}
+
+// Equal keys keep their original order, which is recorded in the second
+// element of each pair
+TEST(stable_sort)
+{
+	std::mt19937 rng(2);
+	for (std::size_t n: sort_sizes()) {
+		std::vector<std::pair<int, std::size_t>> v(n);
+		for (std::size_t i = 0; i < n; i++)
+			v[i] = std::make_pair(static_cast<int>(rng() % 16), i);
+		async::parallel_stable_sort(v.begin(), v.end(), [](const std::pair<int, std::size_t>& a, const std::pair<int, std::size_t>& b) {
+			return a.first < b.first;
+		});
+		bool ok = true;
+		for (std::size_t i = 1; i < n; i++)
+			ok &= v[i - 1].first < v[i].first || (v[i - 1].first == v[i].first && v[i - 1].second < v[i].second);
+		CHECK(ok);
+	}
+}
+
+// Elements are only ever moved, never copied
+TEST(move_only)
+{
+	std::mt19937 rng(3);
+	for (std::size_t n: sort_sizes()) {
+		std::vector<std::unique_ptr<int>> v;
+		for (std::size_t i = 0; i < n; i++)
+			v.emplace_back(new int(static_cast<int>(rng() % 100)));
+		auto less = [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) {
+			return *a < *b;
+		};
+		async::parallel_sort(v.begin(), v.end(), less);
+		CHECK(std::is_sorted(v.begin(), v.end(), less));
+		CHECK(std::all_of(v.begin(), v.end(), [](const std::unique_ptr<int>& p) {
+			return p != nullptr;
+		}));
+
+		std::shuffle(v.begin(), v.end(), rng);
+		async::parallel_stable_sort(v.begin(), v.end(), less);
+		CHECK(std::is_sorted(v.begin(), v.end(), less));
+	}
+}
+
+} // namespace
+
+TEST_MAIN()
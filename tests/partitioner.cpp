@@ -0,0 +1,325 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests that every partitioner visits each element of a range exactly once
+
+#include "test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace {
+
+// Number of times each index of a range was visited
+class visit_counts {
+	std::vector<std::atomic<int>> counts;
+
+public:
+	explicit visit_counts(std::size_t n)
+		: counts(n)
+	{
+		for (auto& i: counts)
+			i = 0;
+	}
+
+	void visit(std::size_t index)
+	{
+		counts[index]++;
+	}
+
+	bool all_once() const
+	{
+		for (auto& i: counts) {
+			if (i.load() != 1)
+				return false;
+		}
+		return true;
+	}
+};
+
+// Every point of a blocked range is visited once, including when the extents
+// aren't multiples of the grain sizes
+TEST(blocked_range_visits)
+{
+	for (int rows: {0, 1, 7, 64, 100}) {
+		for (int cols: {0, 1, 13, 64}) {
+			visit_counts visits(rows * cols);
+			async::parallel_for(async::blocked_range2d<int>(0, rows, 0, cols, 8, 5), [&](const std::array<int, 2>& p) {
+				visits.visit(p[0] * cols + p[1]);
+			});
+			CHECK(visits.all_once());
+		}
+	}
+
+	visit_counts visits(9 * 10 * 11);
+	async::parallel_for(async::blocked_range3d<int>(-4, 5, 0, 10, 3, 14, 2, 3, 4), [&](const std::array<int, 3>& p) {
+		visits.visit(((p[0] + 4) * 10 + p[1]) * 11 + p[2] - 3);
+	});
+	CHECK(visits.all_once());
+}
+
+// Splitting a blocked range divides its longest dimension until every
+// dimension is within its grain size, and the parts cover the whole range
+TEST(blocked_range_split)
+{
+	std::vector<async::blocked_range2d<int>> parts;
+	parts.push_back(async::blocked_range2d<int>(0, 100, 0, 30, 16, 16));
+	std::size_t total = 0;
+	while (!parts.empty()) {
+		auto r = parts.back();
+		parts.pop_back();
+		if (r.is_divisible()) {
+			std::size_t before = r.size();
+			auto other = r.split();
+			CHECK(r.size() + other.size() == before);
+			CHECK(r.size() != 0 && other.size() != 0);
+			parts.push_back(r);
+			parts.push_back(other);
+		} else {
+			CHECK(r.upper(0) - r.lower(0) <= 16);
+			CHECK(r.upper(1) - r.lower(1) <= 16);
+			total += r.size();
+		}
+	}
+	CHECK(total == 3000);
+}
+
+// Segmented ranges split containers without random access iterators at
+// segment boundaries, and know their length without walking the range
+TEST(segmented_visits)
+{
+	for (int n: {0, 1, 5, 1000, 1023}) {
+		std::list<int> l;
+		for (int i = 0; i < n; i++)
+			l.push_back(i);
+		for (std::size_t grain: {std::size_t(1), std::size_t(7), std::size_t(1000)}) {
+			visit_counts visits(n);
+			auto range = async::segmented(l, grain);
+			CHECK(range.size() == static_cast<std::size_t>(n));
+			async::parallel_for(range, [&](int i) {
+				visits.visit(i);
+			});
+			CHECK(visits.all_once());
+
+			// Both halves of a split keep track of their size
+			if (range.is_divisible()) {
+				auto other = range.split();
+				CHECK(range.size() + other.size() == static_cast<std::size_t>(n));
+				CHECK(static_cast<std::size_t>(std::distance(other.begin(), other.end())) == other.size());
+			}
+		}
+	}
+
+	std::map<int, int> m;
+	for (int i = 0; i < 500; i++)
+		m[i] = i;
+	visit_counts visits(500);
+	async::parallel_for(async::segmented(m), [&](const std::pair<const int, int>& kv) {
+		visits.visit(kv.first);
+	});
+	CHECK(visits.all_once());
+	auto it = async::parallel_find_first(async::segmented(m, 16), [](const std::pair<const int, int>& kv) {
+		return kv.second >= 321;
+	});
+	CHECK(it != m.end() && it->first == 321);
+}
+
+// Chunked partitioner which gives up after a couple of chunks and alternates
+// between splitting and chunking, so that the algorithms have to handle the
+// part of the range left over by next_chunk().
+class stopping_partitioner {
+	typedef async::int_range<int>::iterator iterator;
+
+	int first, last, chunk_last;
+	int grain;
+	int chunks_left;
+	bool split_next;
+
+public:
+	stopping_partitioner(int first, int last, int grain)
+		: first(first), last(last), chunk_last(last), grain(grain), chunks_left(0), split_next(true) {}
+
+	iterator begin() const
+	{
+		return async::irange(0, first).end();
+	}
+	iterator end() const
+	{
+		return async::irange(0, chunk_last).end();
+	}
+	std::size_t size() const
+	{
+		return last - first;
+	}
+	stopping_partitioner split()
+	{
+		chunk_last = last;
+		if (last - first > grain && split_next) {
+			split_next = false;
+			int middle = first + (last - first + 1) / 2;
+			stopping_partitioner out(middle, last, grain);
+			last = chunk_last = middle;
+			return out;
+		}
+		split_next = true;
+		chunks_left = 2;
+		chunk_last = std::min(first + grain, last);
+		return stopping_partitioner(last, last, grain);
+	}
+	bool next_chunk()
+	{
+		first = chunk_last;
+		if (first == last || --chunks_left == 0) {
+			chunk_last = last;
+			return false;
+		}
+		chunk_last = std::min(first + grain, last);
+		return true;
+	}
+};
+
+// The left over part of a chunked partitioner is run exactly once by each of
+// the algorithms
+TEST(next_chunk_leftovers)
+{
+	for (int n: {0, 1, 3, 4, 5, 100, 1001}) {
+		visit_counts visits(n);
+		async::parallel_for(stopping_partitioner(0, n, 3), [&](int i) {
+			visits.visit(i);
+		});
+		CHECK(visits.all_once());
+
+		long sum = async::parallel_map_reduce(stopping_partitioner(0, n, 3), 0L, [](int i) {
+			return static_cast<long>(i);
+		}, std::plus<long>());
+		CHECK(sum == static_cast<long>(n) * (n - 1) / 2);
+
+		for (int target: {0, n / 2, n - 1}) {
+			auto it = async::parallel_find_first(stopping_partitioner(0, n, 3), [target](int i) {
+				return i >= target;
+			});
+			CHECK(n == 0 || *it == target);
+		}
+	}
+}
+
+// The lazy partitioner runs everything exactly once, whether it splits or
+// works through its range in chunks. Nested loops make work requests more
+// likely while a range is being chunked.
+TEST(lazy_visits)
+{
+	for (std::size_t grain: {std::size_t(1), std::size_t(3), std::size_t(64)}) {
+		for (std::size_t n: {std::size_t(0), std::size_t(1), grain - 1, grain, grain + 1, std::size_t(10007)}) {
+			visit_counts visits(n);
+			async::parallel_for(async::lazy_partitioner(async::irange(std::size_t(0), n), grain), [&](std::size_t i) {
+				visits.visit(i);
+			});
+			CHECK(visits.all_once());
+		}
+	}
+
+	visit_counts visits(64 * 256);
+	async::parallel_for(async::lazy_partitioner(async::irange(0, 64), 1), [&](int i) {
+		async::parallel_for(async::lazy_partitioner(async::irange(0, 256), 4), [&](int j) {
+			visits.visit(i * 256 + j);
+		});
+	});
+	CHECK(visits.all_once());
+
+	std::list<int> l;
+	for (int i = 0; i < 3000; i++)
+		l.push_back(i);
+	long sum = async::parallel_reduce(async::lazy_partitioner(l, 10), 0L, std::plus<long>());
+	CHECK(sum == 3000L * 2999 / 2);
+}
+
+// Repeated loops with the same affinity partitioner each visit every element
+// once, including when the length of the range changes between loops and when
+// it is empty
+TEST(affinity_visits)
+{
+	async::affinity_partitioner affinity;
+	for (std::size_t n: {std::size_t(1000), std::size_t(1000), std::size_t(1000), std::size_t(0), std::size_t(1), std::size_t(77), std::size_t(1000)}) {
+		visit_counts visits(n);
+		async::parallel_for(affinity(async::irange(std::size_t(0), n)), [&](std::size_t i) {
+			visits.visit(i);
+		});
+		CHECK(visits.all_once());
+
+		long sum = async::parallel_reduce(affinity(async::irange(std::size_t(0), n)), 0L, [](long a, long b) {
+			return a + b;
+		});
+		CHECK(sum == static_cast<long>(n) * (static_cast<long>(n) - 1) / 2);
+	}
+
+	// Affinity partitioner for a thread pool other than the default one
+	async::threadpool_scheduler pool(3);
+	async::affinity_partitioner pool_affinity(pool);
+	for (int repeat = 0; repeat < 5; repeat++) {
+		visit_counts visits(5000);
+		async::parallel_for(pool, pool_affinity(async::irange(0, 5000)), [&](int i) {
+			visits.visit(i);
+		});
+		CHECK(visits.all_once());
+	}
+}
+
+// The adaptive partitioner probes with small chunks before it has an estimate
+// and then splits by the estimate, without losing or repeating any element.
+// The tuner keeps its estimate between loops.
+TEST(adaptive_visits)
+{
+	async::grain_tuner tuner;
+	for (std::size_t n: {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(3), std::size_t(1000), std::size_t(100000)}) {
+		visit_counts visits(n);
+		async::parallel_for(async::adaptive_partitioner(async::irange(std::size_t(0), n), tuner), [&](std::size_t i) {
+			visits.visit(i);
+		});
+		CHECK(visits.all_once());
+	}
+	CHECK(tuner.ns_per_element() > 0);
+
+	// A slow loop body makes each probe chunk long enough to measure
+	visit_counts visits(200);
+	async::parallel_for(async::adaptive_partitioner(async::irange(0, 200)), [&](int i) {
+		auto start = std::chrono::steady_clock::now();
+		while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(20)) {}
+		visits.visit(i);
+	});
+	CHECK(visits.all_once());
+
+	std::list<int> l;
+	for (int i = 0; i < 3000; i++)
+		l.push_back(i);
+	long sum = async::parallel_reduce(async::adaptive_partitioner(l, tuner), 0L, std::plus<long>());
+	CHECK(sum == 3000L * 2999 / 2);
+	auto it = async::parallel_find_first(async::adaptive_partitioner(l), [](int x) {
+		return x == 2500;
+	});
+	CHECK(it != l.end() && *it == 2500);
+}
+
+} // namespace
+
+TEST_MAIN()
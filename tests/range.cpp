@@ -0,0 +1,236 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the range adaptors and their iterator arithmetic
+
+#include "test.h"
+#include <atomic>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Zip iterators move all of the underlying iterators in lockstep
+TEST(zip_arithmetic)
+{
+	std::vector<int> a = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	std::vector<char> b = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l'};
+	auto z = async::zip(a, b);
+	auto first = z.begin();
+	auto last = z.end();
+	CHECK(last - first == 10);
+	CHECK(std::get<0>(first[3]) == 3 && std::get<1>(first[3]) == 'd');
+
+	auto it = first + 7;
+	CHECK(std::get<1>(*it) == 'h');
+	CHECK(it - first == 7 && first - it == -7);
+	CHECK(std::get<0>(*(it - 2)) == 5);
+	CHECK(std::get<0>(*(2 + first)) == 2);
+	--it;
+	CHECK(std::get<1>(*it--) == 'g');
+	CHECK(std::get<1>(*it) == 'f');
+	it += 5;
+	CHECK(it == last);
+	it -= 10;
+	CHECK(it == first);
+	CHECK(first < last && last > first && first <= first && last >= first && first != last);
+
+	// Writing through the references updates every range
+	std::get<0>(*first) = 100;
+	std::get<1>(first[1]) = 'z';
+	CHECK(a[0] == 100 && b[1] == 'z');
+}
+
+// Zipped ranges can be used as the output of a parallel loop
+TEST(zip_parallel_for)
+{
+	std::vector<int> in(10000), out(10000);
+	for (int i = 0; i < 10000; i++)
+		in[i] = i;
+	async::parallel_for(async::zip(in, out), [](std::tuple<int&, int&> t) {
+		std::get<1>(t) = 2 * std::get<0>(t);
+	});
+	bool ok = true;
+	for (int i = 0; i < 10000; i++)
+		ok &= out[i] == 2 * i;
+	CHECK(ok);
+
+	std::vector<int> empty;
+	int calls = 0;
+	async::parallel_for(async::zip(empty, out), [&calls](std::tuple<int&, int&>) {
+		calls++;
+	});
+	CHECK(calls == 0);
+}
+
+// Enumerated ranges pair each element with its index
+TEST(enumerate_indices)
+{
+	std::vector<int> v(5000);
+	for (int i = 0; i < 5000; i++)
+		v[i] = 5000 - i;
+	std::vector<std::atomic<int>> ok(5000);
+	async::parallel_for(async::enumerate(v), [&ok](std::tuple<std::size_t, int&> t) {
+		ok[std::get<0>(t)] = std::get<1>(t) == 5000 - static_cast<int>(std::get<0>(t));
+	});
+	bool all = true;
+	for (auto& i: ok)
+		all &= i.load() == 1;
+	CHECK(all);
+
+	auto e = async::enumerate(v);
+	auto it = e.begin() + 1234;
+	CHECK(std::get<0>(*it) == 1234 && &std::get<1>(*it) == &v[1234]);
+	CHECK(e.end() - it == 5000 - 1234);
+	CHECK(std::get<0>(it[-4]) == 1230);
+}
+
+// Collect the values of a range
+template<typename Range>
+std::vector<long long> values(const Range& r)
+{
+	std::vector<long long> out;
+	for (auto i: r)
+		out.push_back(i);
+	return out;
+}
+
+// Unit-stride ranges, including ones at the limits of their type
+TEST(int_range_values)
+{
+	CHECK(values(async::irange(3, 7)) == (std::vector<long long>{3, 4, 5, 6}));
+	CHECK(values(async::irange(-2, 1)) == (std::vector<long long>{-2, -1, 0}));
+	CHECK(values(async::irange(5, 5)).empty());
+
+	auto r = async::irange(std::numeric_limits<int>::max() - 3, std::numeric_limits<int>::max());
+	CHECK(r.end() - r.begin() == 3);
+	CHECK(*(r.end() - 1) == std::numeric_limits<int>::max() - 1);
+	auto s = async::irange(std::numeric_limits<signed char>::min(), static_cast<signed char>(-126));
+	CHECK(values(s) == (std::vector<long long>{-128, -127}));
+}
+
+// Strided ranges with positive and negative steps, steps which don't divide
+// the distance between the bounds and bounds at the limits of the type
+TEST(strided_int_range_values)
+{
+	CHECK(values(async::irange(0, 10, 3)) == (std::vector<long long>{0, 3, 6, 9}));
+	CHECK(values(async::irange(0, 9, 3)) == (std::vector<long long>{0, 3, 6}));
+	CHECK(values(async::irange(10, 0, -3)) == (std::vector<long long>{10, 7, 4, 1}));
+	CHECK(values(async::irange(10, 1, -3)) == (std::vector<long long>{10, 7, 4}));
+	CHECK(values(async::irange(0, 10, -1)).empty());
+	CHECK(values(async::irange(10, 0, 2)).empty());
+	CHECK(values(async::irange(5, 5, 1)).empty());
+	CHECK(values(async::irange(0, 5, 100)) == (std::vector<long long>{0}));
+
+	// The end can't be reached without overflowing the type
+	typedef unsigned char uchar;
+	CHECK(values(async::irange(uchar(250), uchar(255), 4)) == (std::vector<long long>{250, 254}));
+	CHECK(values(async::irange(uchar(0), uchar(255), 128)) == (std::vector<long long>{0, 128}));
+	CHECK(values(async::irange(uchar(5), uchar(0), -2)) == (std::vector<long long>{5, 3, 1}));
+	typedef signed char schar;
+	CHECK(values(async::irange(schar(-128), schar(127), 100)) == (std::vector<long long>{-128, -28, 72}));
+	CHECK(values(async::irange(schar(127), schar(-128), -127)) == (std::vector<long long>{127, 0, -127}));
+	long long max = std::numeric_limits<long long>::max();
+	long long min = std::numeric_limits<long long>::min();
+	CHECK(values(async::irange(max - 10, max, 4)) == (std::vector<long long>{max - 10, max - 6, max - 2}));
+	CHECK(values(async::irange(min + 5, min, -2)) == (std::vector<long long>{min + 5, min + 3, min + 1}));
+
+	// Iterator arithmetic works on indices, whatever the step
+	auto r = async::irange(100, -100, -7);
+	auto it = r.begin() + 10;
+	CHECK(*it == 30);
+	CHECK(it[-10] == 100 && it[5] == -5);
+	CHECK(r.end() - r.begin() == 29);
+	CHECK(*(r.end() - 1) == -96);
+	CHECK(r.step() == -7);
+
+	// Every value is visited once by a parallel loop
+	std::vector<std::atomic<int>> counts(1000);
+	for (auto& i: counts)
+		i = 0;
+	async::parallel_for(async::irange(999, -1, -3), [&counts](int i) {
+		counts[i]++;
+	});
+	bool ok = true;
+	for (int i = 0; i < 1000; i++)
+		ok &= counts[i].load() == ((999 - i) % 3 == 0 ? 1 : 0);
+	CHECK(ok);
+}
+
+// Collapsed ranges step through the flattened index space in row-major order,
+// whether moved one step at a time or by an offset
+TEST(collapse_arithmetic)
+{
+	std::vector<int> rows = {0, 1, 2};
+	std::vector<int> cols = {0, 1, 2, 3, 4};
+	std::vector<int> pages = {0, 1};
+	auto c = async::collapse(pages, rows, cols);
+	CHECK(c.end() - c.begin() == 30);
+
+	// Incrementing carries into the outer dimensions
+	int flat = 0;
+	bool ok = true;
+	for (auto it = c.begin(); it != c.end(); ++it, flat++) {
+		ok &= std::get<0>(*it) == flat / 15 && std::get<1>(*it) == flat / 5 % 3 && std::get<2>(*it) == flat % 5;
+		ok &= *it == c.begin()[flat];
+		ok &= *it == *(c.begin() + flat);
+	}
+	CHECK(ok);
+
+	// Decrementing borrows from them
+	auto it = c.end();
+	flat = 30;
+	ok = true;
+	while (it != c.begin()) {
+		--it;
+		flat--;
+		ok &= std::get<0>(*it) == flat / 15 && std::get<1>(*it) == flat / 5 % 3 && std::get<2>(*it) == flat % 5;
+	}
+	CHECK(ok && flat == 0);
+
+	it = c.begin() + 17;
+	it -= 6;
+	CHECK(it - c.begin() == 11);
+	CHECK(std::get<1>(*it) == 2 && std::get<2>(*it) == 1);
+	CHECK(std::get<0>(*(it + 4)) == 1);
+	CHECK(it.get_position()[0] == 0 && it.get_position()[1] == 2 && it.get_position()[2] == 1);
+
+	// An empty dimension makes the whole range empty
+	std::vector<int> none;
+	auto e = async::collapse(rows, none, cols);
+	CHECK(e.begin() == e.end());
+
+	// Every pair is visited once by a parallel loop
+	std::vector<std::atomic<int>> counts(37 * 41);
+	for (auto& i: counts)
+		i = 0;
+	async::parallel_for(async::collapse(async::irange(0, 37), async::irange(0, 41)), [&counts](std::tuple<int, int> t) {
+		counts[std::get<0>(t) * 41 + std::get<1>(t)]++;
+	});
+	ok = true;
+	for (auto& i: counts)
+		ok &= i.load() == 1;
+	CHECK(ok);
+}
+
+} // namespace
+
+TEST_MAIN()
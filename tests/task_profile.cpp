@@ -0,0 +1,139 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the task profiler. These only check anything when the library is
+// built with USE_TASK_PROFILE.
+
+#include "test.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Get the profile record with the given name, or an empty record
+async::task_profile_record find_record(const char* name)
+{
+	for (const async::task_profile_record& record: async::get_task_profile()) {
+		if (record.name == name)
+			return record;
+	}
+	async::task_profile_record empty;
+	empty.count = empty.run_time = empty.max_run_time = empty.queue_delay = 0;
+	return empty;
+}
+
+void sleep_ms(int ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+const std::uint64_t ms = 1000000;
+
+TEST(labeled)
+{
+	if (!async::task_profile_enabled())
+		return;
+	async::reset_task_profile();
+	for (int i = 0; i < 3; i++)
+		async::spawn(async::inline_scheduler(), async::labeled("labeled_spawn"), [] {}).get();
+	async::spawn(async::inline_scheduler(), async::labeled("labeled_func", [] {})).get();
+	auto t = async::make_task();
+	t.then(async::inline_scheduler(), async::labeled("labeled_then", [] {})).get();
+
+	async::task_profile_record record = find_record("labeled_spawn");
+	CHECK(record.count == 3);
+	CHECK(record.type_name != record.name);
+	CHECK(find_record("labeled_func").count == 1);
+	CHECK(find_record("labeled_then").count == 1);
+	CHECK(async::task_profile_to_table(async::get_task_profile()).find("labeled_spawn") != std::string::npos);
+}
+
+// The run time of a task leaves out the tasks its thread runs while it waits
+TEST(nested_exclusive_time)
+{
+	if (!async::task_profile_enabled())
+		return;
+	async::reset_task_profile();
+	async::spawn(async::inline_scheduler(), async::labeled("outer"), [] {
+		sleep_ms(5);
+		async::spawn(async::inline_scheduler(), async::labeled("inner"), [] {
+			sleep_ms(30);
+		}).get();
+		sleep_ms(5);
+	}).get();
+
+	async::task_profile_record outer = find_record("outer");
+	async::task_profile_record inner = find_record("inner");
+	CHECK(outer.count == 1);
+	CHECK(inner.count == 1);
+	CHECK(inner.run_time >= 30 * ms);
+	CHECK(outer.run_time >= 10 * ms);
+	CHECK(outer.run_time < 30 * ms);
+	CHECK(outer.max_run_time == outer.run_time);
+}
+
+// Recursive tasks are not counted several times over, so the total run time
+// of a task type can't be more than the time it took to run them all in a
+// single thread
+int fib(int n)
+{
+	if (n < 2)
+		return n;
+	auto a = async::spawn(async::inline_scheduler(), async::labeled("fib"), [n] {
+		return fib(n - 1);
+	});
+	return fib(n - 2) + a.get();
+}
+
+TEST(recursive_tasks)
+{
+	if (!async::task_profile_enabled())
+		return;
+	async::reset_task_profile();
+	auto start = std::chrono::steady_clock::now();
+	fib(16);
+	std::uint64_t elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	async::task_profile_record record = find_record("fib");
+	CHECK(record.count > 0);
+	CHECK(record.run_time <= elapsed);
+}
+
+TEST(reset)
+{
+	if (!async::task_profile_enabled())
+		return;
+	async::spawn(async::inline_scheduler(), async::labeled("reset"), [] {}).get();
+	CHECK(find_record("reset").count != 0);
+	async::reset_task_profile();
+	CHECK(find_record("reset").count == 0);
+	CHECK(async::get_task_profile().empty());
+	async::spawn(async::inline_scheduler(), async::labeled("reset"), [] {}).get();
+	CHECK(find_record("reset").count == 1);
+
+	// Tasks run by other threads are cleared as well
+	async::spawn(async::labeled("reset_pool"), [] {}).get();
+	async::reset_task_profile();
+	CHECK(find_record("reset_pool").count == 0);
+}
+
+} // namespace
+
+TEST_MAIN()
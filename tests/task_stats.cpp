@@ -0,0 +1,142 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the task statistics. These only check anything when the library is
+// built with USE_TASK_STATS.
+
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Run a task in the calling thread, which records its statistics before
+// returning
+template<typename Func>
+void run_inline(Func f)
+{
+	async::spawn(async::inline_scheduler(), f).get();
+}
+
+// Check that the summary of a histogram agrees with its buckets
+bool consistent(const async::task_stats_histogram& hist)
+{
+	typedef async::task_stats_histogram histogram;
+	std::uint64_t total = 0;
+	bool ok = hist.min() <= hist.max();
+	for (std::size_t i = 0; i < histogram::bucket_count; i++) {
+		if (hist.bucket(i) == 0)
+			continue;
+		total += hist.bucket(i);
+		ok &= histogram::bucket_upper_bound(i) >= hist.min() && histogram::bucket_lower_bound(i) <= hist.max();
+	}
+	ok &= total == hist.count();
+	ok &= hist.count() == 0 || (hist.mean() >= static_cast<double>(hist.min()) && hist.mean() <= static_cast<double>(hist.max()));
+	for (double p: {0.0, 50.0, 99.0, 100.0})
+		ok &= hist.count() == 0 || (hist.percentile(p) >= hist.min() && hist.percentile(p) <= hist.max());
+	return ok;
+}
+
+TEST(counts)
+{
+	if (!async::task_stats_enabled())
+		return;
+	async::reset_task_stats();
+	for (int i = 0; i < 100; i++)
+		run_inline([] {});
+	run_inline([] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	});
+	async::task_stats stats = async::get_task_stats();
+	CHECK(stats.run_time.count() == 101);
+	CHECK(stats.queue_delay.count() == 101);
+	CHECK(stats.run_time.max() >= 2000000);
+	CHECK(stats.run_time.percentile(100) == stats.run_time.max());
+	CHECK(consistent(stats.run_time));
+	CHECK(consistent(stats.queue_delay));
+	CHECK(async::task_stats_to_json(stats).find("\"count\": 101") != std::string::npos);
+}
+
+// Tasks run by the thread pool are recorded by its workers, just after the
+// task has finished. Waiting for a task which hasn't finished yet adds a
+// continuation to it, which is a task of its own.
+TEST(thread_pool)
+{
+	if (!async::task_stats_enabled())
+		return;
+	async::reset_task_stats();
+	for (int i = 0; i < 50; i++)
+		async::spawn([] {}).get();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (async::get_task_stats().run_time.count() < 50 && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::yield();
+	CHECK(async::get_task_stats().run_time.count() >= 50);
+}
+
+TEST(reset)
+{
+	if (!async::task_stats_enabled())
+		return;
+	run_inline([] {});
+	async::reset_task_stats();
+	CHECK(async::get_task_stats().run_time.count() == 0);
+	CHECK(async::get_task_stats().run_time.percentile(50) == 0);
+	run_inline([] {});
+	CHECK(async::get_task_stats().run_time.count() == 1);
+	CHECK(async::get_task_stats().queue_delay.count() == 1);
+}
+
+// Resets racing with a thread which is recording must not leave stale counts
+// behind in the histograms
+TEST(reset_while_recording)
+{
+	if (!async::task_stats_enabled())
+		return;
+	std::atomic<bool> stop(false);
+	std::thread recorder([&stop] {
+		while (!stop.load(std::memory_order_relaxed)) {
+			run_inline([] {});
+			run_inline([] {
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			});
+		}
+		run_inline([] {});
+	});
+	for (int i = 0; i < 2000; i++) {
+		async::reset_task_stats();
+		std::this_thread::yield();
+	}
+	stop = true;
+	recorder.join();
+
+	async::task_stats stats = async::get_task_stats();
+	CHECK(stats.run_time.count() >= 1);
+	CHECK(consistent(stats.run_time));
+	CHECK(consistent(stats.queue_delay));
+	for (const async::task_stats& thread_stats: async::get_thread_task_stats()) {
+		CHECK(consistent(thread_stats.run_time));
+		CHECK(consistent(thread_stats.queue_delay));
+	}
+}
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,99 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Small self-contained test harness. Each test is a function registered with
+// TEST(), and CHECK() records a failure without stopping the test. The program
+// runs every test and exits with a non-zero status if any check failed.
+
+#ifndef ASYNCXX_TEST_H_
+#define ASYNCXX_TEST_H_
+
+#include <async++.h>
+#include <cstdio>
+#include <vector>
+
+namespace test {
+
+// Registered test
+struct test_case {
+	const char* name;
+	void (*func)();
+};
+
+inline std::vector<test_case>& registry()
+{
+	static std::vector<test_case> tests;
+	return tests;
+}
+
+// Number of failed checks in the current run
+inline int& failures()
+{
+	static int count = 0;
+	return count;
+}
+
+// Helper to register a test from a static initializer
+struct registrar {
+	registrar(const char* name, void (*func)())
+	{
+		registry().push_back(test_case{name, func});
+	}
+};
+
+inline void check_failed(const char* expr, const char* file, int line)
+{
+	std::printf("%s:%d: check failed: %s\n", file, line, expr);
+	failures()++;
+}
+
+// Run all registered tests, returning the exit status of the program
+inline int run()
+{
+	for (const test_case& t: registry()) {
+		int before = failures();
+		std::printf("%s\n", t.name);
+		t.func();
+		std::printf("%s: %s\n", t.name, failures() == before ? "ok" : "FAILED");
+	}
+	return failures() == 0 ? 0 : 1;
+}
+
+} // namespace test
+
+#define TEST(name) \
+	static void name(); \
+	static test::registrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) \
+			test::check_failed(#expr, __FILE__, __LINE__); \
+	} while (false)
+
+#define TEST_MAIN() \
+	int main() \
+	{ \
+		return test::run(); \
+	}
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the USDT probes. These check the probe notes of the test program
+// itself, and only do anything when the library is built with USE_USDT_PROBES
+// on Linux.
+
+#include "test.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+#if defined(LIBASYNC_HAVE_USDT_PROBES) && defined(__linux__)
+# include <elf.h>
+#endif
+
+namespace {
+
+#if defined(LIBASYNC_HAVE_USDT_PROBES) && defined(__linux__)
+// Probe described by a note in the .note.stapsdt section
+struct probe_note {
+	std::string provider;
+	std::string name;
+	std::string args;
+};
+
+// Read the probe notes of the running program
+std::vector<probe_note> read_probe_notes()
+{
+	std::vector<probe_note> out;
+	std::ifstream file("/proc/self/exe", std::ios::binary);
+	std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (image.size() < sizeof(Elf64_Ehdr))
+		return out;
+	Elf64_Ehdr header;
+	std::memcpy(&header, image.data(), sizeof(header));
+	if (header.e_shoff + header.e_shnum * sizeof(Elf64_Shdr) > image.size() || header.e_shstrndx >= header.e_shnum)
+		return out;
+	std::vector<Elf64_Shdr> sections(header.e_shnum);
+	std::memcpy(sections.data(), image.data() + header.e_shoff, header.e_shnum * sizeof(Elf64_Shdr));
+	const char* names = image.data() + sections[header.e_shstrndx].sh_offset;
+
+	for (const Elf64_Shdr& section: sections) {
+		if (section.sh_type != SHT_NOTE || std::strcmp(names + section.sh_name, ".note.stapsdt") != 0)
+			continue;
+		const char* p = image.data() + section.sh_offset;
+		const char* end = p + section.sh_size;
+		while (p + sizeof(Elf64_Nhdr) <= end) {
+			Elf64_Nhdr note;
+			std::memcpy(&note, p, sizeof(note));
+			const char* name = p + sizeof(note);
+			const char* desc = name + ((note.n_namesz + 3) & ~3u);
+			p = desc + ((note.n_descsz + 3) & ~3u);
+			if (note.n_type != 3 || std::strcmp(name, "stapsdt") != 0)
+				continue;
+
+			// The probe, base and semaphore addresses are followed by the
+			// provider, name and argument strings
+			const char* strings = desc + 3 * 8;
+			probe_note probe;
+			probe.provider = strings;
+			probe.name = strings + probe.provider.size() + 1;
+			probe.args = strings + probe.provider.size() + probe.name.size() + 2;
+			out.push_back(probe);
+		}
+	}
+	return out;
+}
+
+// The probes fired from the headers end up in the program
+TEST(probe_notes)
+{
+	std::set<std::string> names;
+	bool args_ok = true;
+	for (const probe_note& probe: read_probe_notes()) {
+		if (probe.provider != "asyncpp")
+			continue;
+		names.insert(probe.name);
+		args_ok &= probe.args.compare(0, 2, "8@") == 0;
+	}
+	for (const char* name: {"task_created", "task_scheduled", "task_start", "task_end", "task_canceled", "continuation_added"})
+		CHECK(names.count(name) == 1);
+	CHECK(args_ok);
+}
+#endif
+
+// The probes don't change the behaviour of tasks
+TEST(tasks)
+{
+	auto t = async::spawn([] {
+		return 1;
+	}).then([](int x) {
+		return x + 1;
+	});
+	CHECK(t.get() == 2);
+}
+
+} // namespace
+
+TEST_MAIN()
@@ -0,0 +1,63 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of when_any where some of the input tasks have already finished
+
+#include "test.h"
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// The first task has finished before when_any is called, so it sets the result
+// right away while the other tasks are still being registered
+TEST(range_with_finished_task)
+{
+	async::event_task<int> pending;
+	std::vector<async::task<int>> tasks;
+	tasks.push_back(async::make_task(1));
+	tasks.push_back(pending.get_task());
+	tasks.push_back(async::make_task(3));
+
+	auto result = async::when_any(tasks.begin(), tasks.end()).get();
+	CHECK(result.index == 0);
+	CHECK(result.tasks.size() == 3);
+	CHECK(result.tasks[0].get() == 1);
+	CHECK(result.tasks[2].get() == 3);
+
+	pending.set(2);
+	CHECK(result.tasks[1].get() == 2);
+}
+
+TEST(variadic_with_finished_task)
+{
+	async::event_task<int> pending;
+	auto result = async::when_any(async::make_task(1), pending.get_task(), async::make_task(3)).get();
+	CHECK(result.index == 0);
+	CHECK(std::get<0>(result.tasks).get() == 1);
+	CHECK(std::get<2>(result.tasks).get() == 3);
+
+	pending.set(2);
+	CHECK(std::get<1>(result.tasks).get() == 2);
+}
+
+} // namespace
+
+TEST_MAIN()
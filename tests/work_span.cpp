@@ -0,0 +1,96 @@
+// Copyright (c) 2015 Amanieu d'Antras
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Tests of the work/span analysis. These only check anything when the library
+// is built with USE_WORK_SPAN.
+
+#include "test.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::uint64_t ms = 1000000;
+
+void sleep_ms(int n)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(n));
+}
+
+// A chain of continuations can't run in parallel, so its span is its work
+TEST(then_chain)
+{
+	if (!async::work_span_enabled())
+		return;
+	async::work_span_report report;
+	{
+		async::work_span_region region("then_chain", [&report](const async::work_span_report& r) {
+			report = r;
+		});
+		auto t = async::spawn([] {
+			sleep_ms(5);
+		});
+		for (int i = 0; i < 4; i++) {
+			t = t.then([] {
+				sleep_ms(5);
+			});
+		}
+		t.get();
+	}
+	CHECK(report.name == "then_chain");
+	CHECK(report.tasks == 5);
+	CHECK(report.work >= 25 * ms);
+	CHECK(report.span <= report.work);
+	CHECK(report.span >= report.work - 2 * ms);
+	CHECK(report.burdened_span >= report.span + 5 * async::work_span_region::default_spawn_burden);
+	CHECK(report.parallelism() < 1.1);
+}
+
+// Independent tasks joined with when_all have the span of the longest one
+TEST(when_all_spawns)
+{
+	if (!async::work_span_enabled())
+		return;
+	const int n = 8;
+	async::work_span_report report;
+	{
+		async::work_span_region region("when_all", [&report](const async::work_span_report& r) {
+			report = r;
+		});
+		std::vector<async::task<void>> tasks;
+		for (int i = 0; i < n; i++) {
+			tasks.push_back(async::spawn([i] {
+				sleep_ms(2 * (i + 1));
+			}));
+		}
+		async::when_all(tasks).get();
+	}
+	std::uint64_t longest = 2 * n * ms;
+	CHECK(report.tasks == n);
+	CHECK(report.work >= n * (n + 1) * ms);
+	CHECK(report.span >= longest);
+	CHECK(report.span < longest + 5 * ms);
+	CHECK(report.parallelism() > 3);
+}
+
+} // namespace
+
+TEST_MAIN()